@@ -1,93 +1,311 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <memory>
-#include "../token/token.h"
 
 namespace ast {
 
+// === Node kinds, used to dispatch on a node without RTTI ===
+enum class NodeKind : uint8_t {
+    PROGRAM,
+    IDENTIFIER,
+    LET_STATEMENT,
+    RETURN_STATEMENT,
+    EXPRESSION_STATEMENT,
+    INTEGER_LITERAL,
+    PREFIX_EXPRESSION,
+    INFIX_EXPRESSION,
+    BOOLEAN,
+    BLOCK_STATEMENT,
+    IF_EXPRESSION,
+    FUNCTION_LITERAL,
+    CALL_EXPRESSION,
+    ARRAY_LITERAL,
+    INDEX_EXPRESSION,
+    HASH_LITERAL,
+    STRING_LITERAL,
+};
+
+// === Operators ===
+// The operator of a prefix or infix expression, decided by the parser so
+// that evaluating one is a switch rather than string comparisons. The
+// order is part of the cache format (see cache::FORMAT_VERSION).
+enum class Operator : uint8_t {
+    PLUS,
+    MINUS,
+    ASTERISK,
+    SLASH,
+    BANG,
+    LT,
+    GT,
+    EQ,
+    NOT_EQ,
+};
+
+// Number of operators. NOT_EQ must stay the last enumerator.
+constexpr size_t OPERATOR_COUNT = static_cast<size_t>(Operator::NOT_EQ) + 1;
+
+constexpr std::string_view operatorText(Operator op) {
+    switch (op) {
+        case Operator::PLUS: return "+";
+        case Operator::MINUS: return "-";
+        case Operator::ASTERISK: return "*";
+        case Operator::SLASH: return "/";
+        case Operator::BANG: return "!";
+        case Operator::LT: return "<";
+        case Operator::GT: return ">";
+        case Operator::EQ: return "==";
+        case Operator::NOT_EQ: return "!=";
+    }
+    return "";
+}
+
+// === NodeList ===
+// A fixed-size array of child pointers stored in the arena.
+template <typename T>
+class NodeList {
+public:
+    NodeList() : items(nullptr), count(0) {}
+    NodeList(T** items, uint32_t count) : items(items), count(count) {}
+
+    T* operator[](size_t i) const { return items[i]; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T* back() const { return items[count - 1]; }
+    // Replaces a child, e.g. with a node rewritten by the optimizer.
+    void set(size_t i, T* node) { items[i] = node; }
+
+    T* const* begin() const { return items; }
+    T* const* end() const { return items + count; }
+
+private:
+    T** items;
+    uint32_t count;
+};
+
+// === Arena ===
+// A bump allocator owned by a Program. Nodes are placed into large blocks
+// and never destroyed individually; the whole tree goes away with the
+// Program, so node types must be trivially destructible.
+class Arena {
+public:
+    Arena() {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copies items[from..] into the arena as a NodeList of T.
+    template <typename T, typename U>
+    NodeList<T> makeList(const std::vector<U*>& items, size_t from = 0) {
+        size_t count = items.size() - from;
+        if (count == 0) {
+            return NodeList<T>();
+        }
+        T** list = static_cast<T**>(allocate(count * sizeof(T*), alignof(T*)));
+        for (size_t i = 0; i < count; i++) {
+            list[i] = static_cast<T*>(items[from + i]);
+        }
+        return NodeList<T>(list, static_cast<uint32_t>(count));
+    }
+
+    // Copies text into the arena, e.g. an identifier's name.
+    std::string_view copyString(std::string_view s) {
+        if (s.empty()) {
+            return std::string_view();
+        }
+        char* dst = static_cast<char*>(allocate(s.size(), 1));
+        std::memcpy(dst, s.data(), s.size());
+        return std::string_view(dst, s.size());
+    }
+
+    void* allocate(size_t size, size_t align) {
+        size_t offset = (align - reinterpret_cast<uintptr_t>(cursor) % align) % align;
+        if (cursor == nullptr || offset + size > static_cast<size_t>(limit - cursor)) {
+            grow(size + align);
+            offset = (align - reinterpret_cast<uintptr_t>(cursor) % align) % align;
+        }
+        char* p = cursor + offset;
+        cursor = p + size;
+        used += offset + size;
+        return p;
+    }
+
+    size_t bytesUsed() const { return used; }
+    size_t blockCount() const { return blocks.size(); }
+
+private:
+    static constexpr size_t MIN_BLOCK_SIZE = 4 * 1024;
+    static constexpr size_t MAX_BLOCK_SIZE = 256 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t nextBlockSize = MIN_BLOCK_SIZE;
+    size_t used = 0;
+
+    // Blocks double in size so a one-line REPL program stays small while a
+    // large script needs only a handful of them.
+    void grow(size_t minSize) {
+        size_t size = nextBlockSize > minSize ? nextBlockSize : minSize;
+        if (nextBlockSize < MAX_BLOCK_SIZE) {
+            nextBlockSize *= 2;
+        }
+        blocks.emplace_back(new char[size]);
+        cursor = blocks.back().get();
+        limit = cursor + size;
+    }
+};
+
 // === Base AST Interface ===
+// Nodes are plain data laid out in a Program's arena. Children are raw
+// pointers into the same arena and names are views of arena text, so
+// nodes own nothing.
 class Node {
 public:
-    virtual std::string tokenLiteral() const = 0;
-    virtual std::string toString() const = 0;
-    virtual ~Node() {}
+    const NodeKind kind;
+
+    explicit Node(NodeKind kind) : kind(kind) {}
+
+    std::string toString() const;
 };
 
 class Statement : public Node {
 public:
-    virtual void statementNode() = 0;
+    using Node::Node;
 };
 
 class Expression : public Node {
 public:
-    virtual void expressionNode() = 0;
+    using Node::Node;
+};
+
+class FunctionLiteral;
+
+// === Call site cache ===
+// Filled in by the evaluator: the literal of the function the call site
+// called last, and a spare call frame for it, so a site that keeps calling
+// the same function reuses one frame instead of allocating a new one per
+// call. The frame is a shared_ptr, so unlike nodes the caches have to be
+// destroyed: they live in the arena but are destroyed by their Program.
+struct CallSiteCache {
+    const FunctionLiteral* literal = nullptr;
+    std::shared_ptr<void> frame;
+    CallSiteCache* next = nullptr; // the Program's list of caches
+};
+
+// === Literal constant ===
+// The runtime object of a literal that needs one (a string), created once
+// by resolver::Resolver so that evaluating the literal only copies it.
+// Destroyed by the Program, like call site caches.
+struct LiteralConstant {
+    std::shared_ptr<void> object;
+    LiteralConstant* next = nullptr; // the Program's list of constants
 };
 
 // === Program (root node) ===
-class Program : public Node {
+// The only node that lives outside the arena: it owns the arena. Values
+// that keep pointers into the tree (evaluator functions) hold a
+// shared_ptr to the Program.
+class Program : public Node, public std::enable_shared_from_this<Program> {
 public:
-    std::vector<std::shared_ptr<Statement>> statements;
-
-    std::string tokenLiteral() const override {
-        if(statements.size() > 0) {
-            return statements[0]->tokenLiteral(); // returns the first statement's token literal, e.g., "let x = 5;" => "let"
-        } else {
-            return "";
+    Arena arena;
+    NodeList<Statement> statements;
+
+    Program() : Node(NodeKind::PROGRAM) {}
+    Program(const Program&) = delete;
+    Program& operator=(const Program&) = delete;
+    ~Program() {
+        for (CallSiteCache* cache = callSites; cache != nullptr;) {
+            CallSiteCache* next = cache->next;
+            cache->~CallSiteCache();
+            cache = next;
+        }
+        for (LiteralConstant* constant = constants; constant != nullptr;) {
+            LiteralConstant* next = constant->next;
+            constant->~LiteralConstant();
+            constant = next;
         }
     }
 
-    std::string toString() const override {
+    // A cache for a new CallExpression.
+    CallSiteCache* newCallSite() {
+        auto cache = new (arena.allocate(sizeof(CallSiteCache), alignof(CallSiteCache))) CallSiteCache();
+        cache->next = callSites;
+        callSites = cache;
+        return cache;
+    }
+
+    // The constant of a new literal node.
+    LiteralConstant* newConstant() {
+        auto constant = new (arena.allocate(sizeof(LiteralConstant), alignof(LiteralConstant))) LiteralConstant();
+        constant->next = constants;
+        constants = constant;
+        return constant;
+    }
+
+    std::string toString() const {
         std::string result;
 
-        for(const auto& s : statements) {
+        for(const auto s : statements) {
             result += s->toString();
         }
         return result;
     }
+
+private:
+    CallSiteCache* callSites = nullptr;
+    LiteralConstant* constants = nullptr;
 };
 
 // === Identifier Expression ===
 class Identifier : public Expression {
 public:
-    token::Token token;
-    std::string value;
-
-    Identifier(token::Token token, std::string value)
-        : token(token), value(value) {}
-
-    void expressionNode() override {}
-
-    std::string tokenLiteral() const override {
-        return token.literal;
-    }
-
-    std::string toString() const override {
-        return value;
+    std::string_view value;
+    // Filled in by resolver::Resolver: the binding lives in the environment
+    // `depth` frames up, at index `slot`. A slot of -1 means the name could
+    // not be resolved statically and is looked up in the globals table.
+    int depth = -1;
+    int slot = -1;
+    // The binding of the same name in an enclosing function, if any, which
+    // is read while this one's slot is still unbound, as a search by name
+    // would: a closure may run before a later let of the name in its own
+    // or an enclosing body. The globals table comes after the last one.
+    const Identifier* shadowed = nullptr;
+
+    Identifier(std::string_view value)
+        : Expression(NodeKind::IDENTIFIER), value(value) {}
+
+    std::string toString() const {
+        return std::string(value);
     }
 };
 
 // === Let Statement ===
 class LetStatement : public Statement {
 public:
-    token::Token token;
-    std::shared_ptr<Identifier> name;
-    std::shared_ptr<Expression> value;
+    Identifier* name;
+    Expression* value;
 
-    LetStatement(token::Token token, std::shared_ptr<Identifier> name, std::shared_ptr<Expression> value)
-        : token(token), name(name), value(value) {}
+    LetStatement(Identifier* name, Expression* value)
+        : Statement(NodeKind::LET_STATEMENT), name(name), value(value) {}
 
-    void statementNode() override {}
-
-    std::string tokenLiteral() const override {
-        return token.literal;
-    }
-
-    std::string toString() const override {
+    std::string toString() const {
         std::string result;
 
-        result = tokenLiteral() + " " + name->toString() + " = ";
+        result = "let " + name->toString() + " = ";
         if(value != nullptr) {
             result += value->toString();
         }
@@ -99,22 +317,15 @@ public:
 // === Return Statement ===
 class ReturnStatement : public Statement {
 public:
-    token::Token token;
-    std::shared_ptr<Expression> returnValue;
+    Expression* returnValue;
 
-    ReturnStatement(token::Token token, std::shared_ptr<Expression> returnValue)
-        : token(token), returnValue(returnValue) {}
-    
-    void statementNode() override {}
+    ReturnStatement(Expression* returnValue)
+        : Statement(NodeKind::RETURN_STATEMENT), returnValue(returnValue) {}
 
-    std::string tokenLiteral() const override {
-        return token.literal;
-    }
-
-    std::string toString() const override {
+    std::string toString() const {
         std::string result;
 
-        result += tokenLiteral() + " ";
+        result += "return ";
         if(returnValue != nullptr) {
             result += returnValue->toString();
         }
@@ -126,19 +337,12 @@ public:
 // === ExpressionStatement ===
 class ExpressionStatement : public Statement {
 public:
-    token::Token token;
-    std::shared_ptr<Expression> expression;
+    Expression* expression;
 
-    ExpressionStatement(token::Token token, std::shared_ptr<Expression> expression)
-        : token(token), expression(expression) {}
-    
-    void statementNode() override {}
+    ExpressionStatement(Expression* expression)
+        : Statement(NodeKind::EXPRESSION_STATEMENT), expression(expression) {}
 
-    std::string tokenLiteral() const override {
-        return token.literal;
-    }
-
-    std::string toString() const override {
+    std::string toString() const {
         if(expression != nullptr) {
             return expression -> toString();
         }
@@ -149,43 +353,43 @@ public:
 // === Integer Literal ===
 class IntegerLiteral : public Expression {
 public:
-    token::Token token;
     int64_t value;
 
-    IntegerLiteral(token::Token token, int value)
-        : token(token), value(value) {}
-    
-    void expressionNode() override {}
+    IntegerLiteral(int64_t value)
+        : Expression(NodeKind::INTEGER_LITERAL), value(value) {}
 
-    std::string tokenLiteral() const override {
-        return token.literal;
+    std::string toString() const {
+        return std::to_string(value);
     }
+};
+
+// === String Literal ===
+class StringLiteral : public Expression {
+public:
+    std::string_view value; // without the quotes, stored in the arena
+    LiteralConstant* constant; // the interned string, once resolved
 
-    std::string toString() const override {
-        return token.literal;
+    StringLiteral(std::string_view value, LiteralConstant* constant)
+        : Expression(NodeKind::STRING_LITERAL), value(value), constant(constant) {}
+
+    std::string toString() const {
+        return std::string(value);
     }
 };
 
 // === Prefix Expression ===
 class PrefixExpression : public Expression {
 public:
-    token::Token token;
-    std::string op;
-    std::shared_ptr<Expression> right;
-
-    PrefixExpression(token::Token token, std::string op, std::shared_ptr<Expression> right)
-        : token(token), op(op), right(right) {}
-    
-    void expressionNode() override {}
+    Operator op;
+    Expression* right;
 
-    std::string tokenLiteral() const override {
-        return token.literal;
-    }
+    PrefixExpression(Operator op, Expression* right)
+        : Expression(NodeKind::PREFIX_EXPRESSION), op(op), right(right) {}
 
-    std::string toString() const override {
+    std::string toString() const {
         std::string result;
 
-        result += "(" + op + right->toString() + ")";
+        result += "(" + std::string(operatorText(op)) + right->toString() + ")";
         return result;
     }
 };
@@ -193,24 +397,17 @@ public:
 // === Infix Expression ===
 class InfixExpression : public Expression {
 public:
-    token::Token token;
-    std::shared_ptr<Expression> left;
-    std::string op;
-    std::shared_ptr<Expression> right;
-
-    InfixExpression(token::Token token, std::shared_ptr<Expression> left, std::string op, std::shared_ptr<Expression> right)
-        : token(token), left(left), op(op), right(right) {}
-    
-    void expressionNode() override {}
-
-    std::string tokenLiteral() const override {
-        return token.literal;
-    }
+    Expression* left;
+    Operator op;
+    Expression* right;
+
+    InfixExpression(Expression* left, Operator op, Expression* right)
+        : Expression(NodeKind::INFIX_EXPRESSION), left(left), op(op), right(right) {}
 
-    std::string toString() const override {
+    std::string toString() const {
         std::string result;
 
-        result += "(" + left -> toString() + " " + op + " " + right -> toString() + ")";
+        result += "(" + left -> toString() + " " + std::string(operatorText(op)) + " " + right -> toString() + ")";
         return result;
     }
 };
@@ -218,42 +415,28 @@ public:
 // === Boolean Expression ===
 class Boolean : public Expression {
 public:
-    token::Token token;
     bool value;
 
-    Boolean(token::Token token, bool value)
-        : token(token), value(value) {}
-    
-    void expressionNode() override {}
-
-    std::string tokenLiteral() const override {
-        return token.literal;
-    }
+    Boolean(bool value)
+        : Expression(NodeKind::BOOLEAN), value(value) {}
 
-    std::string toString() const override {
-        return token.literal;
+    std::string toString() const {
+        return value ? "true" : "false";
     }
 };
 
 // === Block Statement ===
 class BlockStatement : public Statement {
 public:
-    token::Token token;
-    std::vector<std::shared_ptr<Statement>> statements;
-
-    BlockStatement(token::Token token, std::vector<std::shared_ptr<Statement>> statements)
-        : token(token), statements(statements) {}
-    
-    void statementNode() override {}
+    NodeList<Statement> statements;
 
-    std::string tokenLiteral() const override {
-        return token.literal;
-    }
+    BlockStatement(NodeList<Statement> statements)
+        : Statement(NodeKind::BLOCK_STATEMENT), statements(statements) {}
 
-    std::string toString() const override {
+    std::string toString() const {
         std::string result;
 
-        for(const auto& s : statements) {
+        for(const auto s : statements) {
             result += s -> toString();
         }
         return result;
@@ -263,21 +446,14 @@ public:
 // === If Expression ===
 class IfExpression : public Expression {
 public:
-    token::Token token;
-    std::shared_ptr<Expression> condition;
-    std::shared_ptr<BlockStatement> consequence;
-    std::shared_ptr<BlockStatement> alternative;
-
-    IfExpression(token::Token token, std::shared_ptr<Expression> condition, std::shared_ptr<BlockStatement> consequence, std::shared_ptr<BlockStatement> alternative)
-        : token(token), condition(condition), consequence(consequence), alternative(alternative) {}
-    
-    void expressionNode() override {}
-
-    std::string tokenLiteral() const override {
-        return token.literal;
-    }
+    Expression* condition;
+    BlockStatement* consequence;
+    BlockStatement* alternative;
+
+    IfExpression(Expression* condition, BlockStatement* consequence, BlockStatement* alternative)
+        : Expression(NodeKind::IF_EXPRESSION), condition(condition), consequence(consequence), alternative(alternative) {}
 
-    std::string toString() const override {
+    std::string toString() const {
         std::string result;
 
         result += "if" + condition->toString() + " " + consequence->toString();
@@ -291,25 +467,21 @@ public:
 // === Function Literal ===
 class FunctionLiteral : public Expression {
 public:
-    token::Token token;
-    std::vector<std::shared_ptr<Identifier>> parameters;
-    std::shared_ptr<BlockStatement> body;
+    NodeList<Identifier> parameters;
+    BlockStatement* body;
+    Program* program; // the owner of this node's arena
+    std::string_view name; // set when the literal is bound by a let statement
+    int frameSize = 0; // parameters plus let bindings, computed by the resolver
+    bool memoized = false; // written `memo fn`: calls are cached by argument values
 
-    FunctionLiteral(token::Token token, std::vector<std::shared_ptr<Identifier>> parameters, std::shared_ptr<BlockStatement> body)
-        : token(token), parameters(parameters), body(body) {}
-    
-    void expressionNode() override {}
+    FunctionLiteral(NodeList<Identifier> parameters, BlockStatement* body, Program* program)
+        : Expression(NodeKind::FUNCTION_LITERAL), parameters(parameters), body(body), program(program) {}
 
-    std::string tokenLiteral() const override {
-        return token.literal;
-    }  
-
-    std::string toString() const override {
+    std::string toString() const {
         std::string result;
 
-        std::vector<std::string> params;
-        result += tokenLiteral() + "(";
-        for(int i=0;i<parameters.size();i++) {
+        result += memoized ? "memo fn(" : "fn(";
+        for(size_t i=0;i<parameters.size();i++) {
             result += parameters[i] -> toString();
             if(i < parameters.size() - 1) {
                 result += ", ";
@@ -323,24 +495,21 @@ public:
 // === Call Expression ===
 class CallExpression : public Expression {
 public:
-    token::Token token;
-    std::shared_ptr<Expression> function;
-    std::vector<std::shared_ptr<Expression>> arguments;
+    Expression* function;
+    NodeList<Expression> arguments;
+    // Set by the resolver when the call's value is the value of the
+    // enclosing function, so the evaluator can run it without recursing.
+    bool tail = false;
+    CallSiteCache* cache;
 
-    CallExpression(token::Token token, std::shared_ptr<Expression> function, std::vector<std::shared_ptr<Expression>> arguments)
-        : token(token), function(function), arguments(arguments) {}
-    
-    void expressionNode() override {}
+    CallExpression(Expression* function, NodeList<Expression> arguments, CallSiteCache* cache)
+        : Expression(NodeKind::CALL_EXPRESSION), function(function), arguments(arguments), cache(cache) {}
 
-    std::string tokenLiteral() const override {
-        return token.literal;
-    }
-
-    std::string toString() const override {
+    std::string toString() const {
         std::string result;
 
         result += function -> toString() + "(";
-        for(int i=0;i<arguments.size();i++) {
+        for(size_t i=0;i<arguments.size();i++) {
             result += arguments[i] -> toString();
             if(i < arguments.size() - 1) {
                 result += ", ";
@@ -351,4 +520,92 @@ public:
     }
 };
 
-}
\ No newline at end of file
+// === Array Literal ===
+class ArrayLiteral : public Expression {
+public:
+    NodeList<Expression> elements;
+
+    ArrayLiteral(NodeList<Expression> elements)
+        : Expression(NodeKind::ARRAY_LITERAL), elements(elements) {}
+
+    std::string toString() const {
+        std::string result;
+
+        result += "[";
+        for(size_t i=0;i<elements.size();i++) {
+            result += elements[i] -> toString();
+            if(i < elements.size() - 1) {
+                result += ", ";
+            }
+        }
+        result += "]";
+        return result;
+    }
+};
+
+// === Index Expression ===
+class IndexExpression : public Expression {
+public:
+    Expression* left;
+    Expression* index;
+
+    IndexExpression(Expression* left, Expression* index)
+        : Expression(NodeKind::INDEX_EXPRESSION), left(left), index(index) {}
+
+    std::string toString() const {
+        return "(" + left -> toString() + "[" + index -> toString() + "])";
+    }
+};
+
+// === Hash Literal ===
+class HashLiteral : public Expression {
+public:
+    // Keys and values alternate: key 0, value 0, key 1, value 1, ...
+    NodeList<Expression> pairs;
+
+    HashLiteral(NodeList<Expression> pairs)
+        : Expression(NodeKind::HASH_LITERAL), pairs(pairs) {}
+
+    size_t size() const { return pairs.size() / 2; }
+    Expression* key(size_t i) const { return pairs[2 * i]; }
+    Expression* value(size_t i) const { return pairs[2 * i + 1]; }
+
+    std::string toString() const {
+        std::string result;
+
+        result += "{";
+        for(size_t i=0;i<size();i++) {
+            result += key(i) -> toString() + ":" + value(i) -> toString();
+            if(i < size() - 1) {
+                result += ", ";
+            }
+        }
+        result += "}";
+        return result;
+    }
+};
+
+inline std::string Node::toString() const {
+    switch (kind) {
+        case NodeKind::PROGRAM: return static_cast<const Program*>(this)->toString();
+        case NodeKind::IDENTIFIER: return static_cast<const Identifier*>(this)->toString();
+        case NodeKind::LET_STATEMENT: return static_cast<const LetStatement*>(this)->toString();
+        case NodeKind::RETURN_STATEMENT: return static_cast<const ReturnStatement*>(this)->toString();
+        case NodeKind::EXPRESSION_STATEMENT: return static_cast<const ExpressionStatement*>(this)->toString();
+        case NodeKind::INTEGER_LITERAL: return static_cast<const IntegerLiteral*>(this)->toString();
+        case NodeKind::PREFIX_EXPRESSION: return static_cast<const PrefixExpression*>(this)->toString();
+        case NodeKind::INFIX_EXPRESSION: return static_cast<const InfixExpression*>(this)->toString();
+        case NodeKind::BOOLEAN: return static_cast<const Boolean*>(this)->toString();
+        case NodeKind::BLOCK_STATEMENT: return static_cast<const BlockStatement*>(this)->toString();
+        case NodeKind::IF_EXPRESSION: return static_cast<const IfExpression*>(this)->toString();
+        case NodeKind::FUNCTION_LITERAL: return static_cast<const FunctionLiteral*>(this)->toString();
+        case NodeKind::CALL_EXPRESSION: return static_cast<const CallExpression*>(this)->toString();
+        case NodeKind::ARRAY_LITERAL: return static_cast<const ArrayLiteral*>(this)->toString();
+        case NodeKind::INDEX_EXPRESSION: return static_cast<const IndexExpression*>(this)->toString();
+        case NodeKind::HASH_LITERAL: return static_cast<const HashLiteral*>(this)->toString();
+        case NodeKind::STRING_LITERAL: return static_cast<const StringLiteral*>(this)->toString();
+    }
+    return "";
+}
+
+}
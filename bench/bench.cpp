@@ -0,0 +1,295 @@
+// Throughput benchmark for the interpreter pipeline.
+//
+// Runs a fixed corpus of programs and measures each stage on its own:
+// lexing (lexer::Lexer::nextToken), parsing (parser::Parser::parseProgram)
+// and evaluation (evaluator::eval, after resolution). For every stage it
+// reports time, throughput and heap allocations, and for every program the
+// call site cache hit rate and the peak RSS of the process so far.
+//
+// With --isolates it instead runs each program in 1, 2, 4, ... 32
+// isolate::Isolates at once, one per thread, and reports how the number of
+// programs run per second scales.
+//
+//   ./monkey_bench                  run the whole corpus
+//   ./monkey_bench fib              run only the programs whose name contains "fib"
+//   ./monkey_bench --isolates fib   scaling of fib across threads
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../resolver/resolver.h"
+#include "../optimizer/optimizer.h"
+#include "../evaluator/evaluator.h"
+#include "../environment/environment.h"
+#include "../isolate/isolate.h"
+#include "../simd/simd.h"
+
+// === Allocation counting ===
+// Every heap allocation in the process goes through these replacements.
+// The counts are per thread, so isolates running at once do not contend
+// for them.
+namespace {
+thread_local size_t allocationCount = 0;
+thread_local size_t allocatedBytes = 0;
+
+void* countedAllocate(size_t size) {
+    allocationCount++;
+    allocatedBytes += size;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+}
+
+void* operator new(size_t size) { return countedAllocate(size); }
+void* operator new[](size_t size) { return countedAllocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Program {
+    std::string name;
+    std::string source;
+    int repeat; // times the lexer and parser stages run over the source
+};
+
+// === Corpus ===
+std::string fibProgram() {
+    return "let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };\n"
+           "fib(24);\n";
+}
+
+std::string closuresProgram() {
+    return "let adder = fn(a) { fn(b) { fn(c) { fn(d) { a + b + c + d } } } };\n"
+           "let loop = fn(i, acc) { if (i == 0) { acc } else { loop(i - 1, acc + adder(i)(1)(2)(3)) } };\n"
+           "loop(50000, 0);\n";
+}
+
+std::string arithmeticProgram() {
+    std::string body = "x";
+    const char* ops[] = {" + ", " * ", " - ", " + "};
+    for (int i = 1; i <= 2000; i++) {
+        body += ops[i % 4];
+        body += (i % 3 == 0) ? "x" : std::to_string(i % 97);
+    }
+    return "let chain = fn(x) { " + body + " };\n"
+           "let loop = fn(i, acc) { if (i == 0) { acc } else { loop(i - 1, acc + chain(i)) } };\n"
+           "loop(200, 0);\n";
+}
+
+std::string generatedProgram() {
+    std::string src;
+    for (int i = 0; i < 26; i++) {
+        src += "let g";
+        src += static_cast<char>('a' + i);
+        src += " = fn(x, y) {\n  if (x < y) { x * 2 + y - 1 } else { return y / (x + 3); }\n};\n";
+    }
+    for (int i = 0; i < 20000; i++) {
+        src += "let v = ga(" + std::to_string(i) + ", 7) + gb(1, 2) * -3 + gc(v, " + std::to_string(i % 13) + ");\n";
+    }
+    return "let v = 0;\n" + src + "v;\n";
+}
+
+std::string arraysProgram() {
+    std::string elements;
+    for (int i = 0; i < 4096; i++) {
+        if (i > 0) {
+            elements += ", ";
+        }
+        elements += std::to_string((i * 7919) % 1000);
+    }
+    return "let a = [" + elements + "];\n"
+           "let loop = fn(i, acc) { if (i == 0) { acc } else { loop(i - 1, acc + sum(a) + dot(a, a) + max(a) + len(filter_gt(a + a, 999))) } };\n"
+           "loop(2000, 0);\n";
+}
+
+// Early returns at every level, the pattern that used to allocate a return
+// value wrapper per `return`.
+std::string returnsProgram() {
+    return "let clamp = fn(x, lo, hi) { if (x < lo) { return lo; } if (x > hi) { return hi; } return x; };\n"
+           "let classify = fn(x) { if (x < 100) { return 0; } if (x < 200) { return 1; } return 2; };\n"
+           "let loop = fn(i, acc) { if (i == 0) { return acc; } return loop(i - 1, acc + clamp(i / 400, 50, 450) + classify(i / 1000)); };\n"
+           "loop(200000, 0);\n";
+}
+
+std::vector<Program> corpus() {
+    return {
+        {"fib", fibProgram(), 20000},
+        {"closures", closuresProgram(), 20000},
+        {"arithmetic", arithmeticProgram(), 200},
+        {"generated", generatedProgram(), 5},
+        {"arrays", arraysProgram(), 200},
+        {"returns", returnsProgram(), 20000},
+    };
+}
+
+// === Measurement ===
+struct Measurement {
+    double seconds = 0;
+    size_t allocations = 0;
+    size_t bytes = 0;
+};
+
+Measurement measure(const std::function<void()>& stage) {
+    size_t allocationsBefore = allocationCount;
+    size_t bytesBefore = allocatedBytes;
+    auto start = Clock::now();
+    stage();
+    Measurement m;
+    m.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    m.allocations = allocationCount - allocationsBefore;
+    m.bytes = allocatedBytes - bytesBefore;
+    return m;
+}
+
+long peakRssKilobytes() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void printRow(const std::string& program, const char* stage, const Measurement& m, double rate, const char* unit) {
+    std::printf("%-12s %-6s %10.2f ms %14.2f %-10s %10zu allocs %12zu bytes\n",
+                program.c_str(), stage, m.seconds * 1000, rate, unit, m.allocations, m.bytes);
+}
+
+void run(const Program& program) {
+    // lexer: tokens only, nothing else allocated per token
+    size_t tokens = 0;
+    auto lex = measure([&]() {
+        for (int i = 0; i < program.repeat; i++) {
+            lexer::Lexer l(program.source, lexer::SourceMode::BORROW);
+            while (l.nextToken().type != token::TokenType::EOF_TOKEN) {
+                tokens++;
+            }
+        }
+    });
+    double megabytes = static_cast<double>(program.source.size()) * program.repeat / (1024.0 * 1024.0);
+    printRow(program.name, "lex", lex, megabytes / lex.seconds, "MB/s");
+
+    // parser: includes its own lexing, as it does in the interpreter
+    std::shared_ptr<ast::Program> tree;
+    bool parseErrors = false;
+    auto parse = measure([&]() {
+        for (int i = 0; i < program.repeat; i++) {
+            auto l = std::make_shared<lexer::Lexer>(program.source, lexer::SourceMode::BORROW);
+            parser::Parser p(l);
+            tree = p.parseProgram();
+            parseErrors = parseErrors || !p.errors().empty();
+        }
+    });
+    if (parseErrors) {
+        std::printf("%-12s parse errors, skipped\n", program.name.c_str());
+        return;
+    }
+    double nodes = static_cast<double>(optimizer::countNodes(tree.get())) * program.repeat;
+    printRow(program.name, "parse", parse, nodes / parse.seconds, "nodes/s");
+
+    // evaluator: one run over the last parsed tree
+    object::Value result;
+    uint64_t evaluatedBefore = evaluator::evaluatedNodeCount();
+    auto callSitesBefore = evaluator::callSiteStats();
+    auto eval = measure([&]() {
+        auto env = object::newEnvironment();
+        resolver::Resolver(env).resolve(tree);
+        result = evaluator::eval(tree, env);
+    });
+    double operations = static_cast<double>(evaluator::evaluatedNodeCount() - evaluatedBefore);
+    printRow(program.name, "eval", eval, operations / eval.seconds, "ops/s");
+    auto callSites = evaluator::callSiteStats();
+    std::printf("%-12s calls  %llu call site cache hits, %llu misses\n", program.name.c_str(),
+                static_cast<unsigned long long>(callSites.hits - callSitesBefore.hits),
+                static_cast<unsigned long long>(callSites.misses - callSitesBefore.misses));
+
+    std::printf("%-12s result %s, %zu tokens/pass, peak RSS %ld KB\n\n",
+                program.name.c_str(), result.inspect().c_str(), tokens / program.repeat, peakRssKilobytes());
+}
+
+// === Isolates ===
+// Runs the program in `count` isolates at once, each created, run and
+// destroyed on a thread of its own. Returns the wall time from the moment
+// all threads are released, and the results in `results`.
+double runIsolates(const Program& program, size_t count, std::vector<std::string>& results) {
+    results.assign(count, std::string());
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < count; i++) {
+        threads.emplace_back([&, i]() {
+            ready++;
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            isolate::Isolate isolate;
+            std::vector<std::string> errors;
+            auto result = isolate.run(program.source, errors);
+            results[i] = errors.empty() ? result.inspect() : "parse errors";
+        });
+    }
+    while (ready.load() < count) {
+        std::this_thread::yield();
+    }
+    auto start = Clock::now();
+    go = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void scale(const Program& program) {
+    double single = 0;
+    for (size_t count = 1; count <= 32; count *= 2) {
+        std::vector<std::string> results;
+        double seconds = runIsolates(program, count, results);
+        if (count == 1) {
+            single = seconds;
+        }
+        bool agree = true;
+        for (const auto& result : results) {
+            agree = agree && result == results[0];
+        }
+        std::printf("%-12s %2zu isolates %10.2f ms %10.2f runs/s %6.2fx%s\n", program.name.c_str(), count,
+                    seconds * 1000, count / seconds, count * single / seconds, agree ? "" : "  results differ");
+    }
+    std::printf("%-12s hardware threads: %u\n\n", program.name.c_str(), std::thread::hardware_concurrency());
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    bool isolates = argc > 1 && std::strcmp(argv[1], "--isolates") == 0;
+    int next = isolates ? 2 : 1;
+    const char* filter = argc > next ? argv[next] : nullptr;
+    std::printf("array kernels: %s\n\n", simd::levelName(simd::level()));
+
+    for (const auto& program : corpus()) {
+        if (filter != nullptr && program.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        if (isolates) {
+            scale(program);
+        } else {
+            run(program);
+        }
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "builtins.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../parallel/parallel.h"
+#include "../simd/simd.h"
+
+namespace builtins {
+
+using object::Value;
+using object::Error;
+using object::IntArray;
+
+namespace {
+ApplyFunction apply = nullptr;
+Allocator allocator = {
+    [] { return std::make_shared<IntArray>(); },
+    [](std::string message) { return std::make_shared<Error>(std::move(message)); },
+};
+
+// The parallel builtins split an array into this many chunks at most. The
+// split depends only on the array's length, so preduce combines the same
+// partial results however many threads run them.
+constexpr size_t MAX_CHUNKS = 256;
+
+Value error(const std::string& message) {
+    return allocator.error(message);
+}
+
+Value checkArgumentCount(size_t count, size_t want) {
+    if (count != want) {
+        return error("wrong number of arguments: want=" + std::to_string(want) + ", got=" + std::to_string(count));
+    }
+    return Value::null();
+}
+
+// The array argument of a builtin, or nullptr if args[i] is not one.
+const IntArray* arrayArgument(const Value* args, size_t i) {
+    if (!args[i].is(object::ObjectType::INT_ARRAY_OBJ)) {
+        return nullptr;
+    }
+    return static_cast<const IntArray*>(args[i].object().get());
+}
+
+Value argumentError(const char* name, const char* want, const Value& got) {
+    return error(std::string("argument to `") + name + "` must be " + want + ", got " + object::typeName(got.type()));
+}
+
+Value len(const Value* args, size_t count) {
+    auto err = checkArgumentCount(count, 1);
+    if (!err.isNull()) return err;
+    if (args[0].is(object::ObjectType::HASH_OBJ)) {
+        return Value::integer(static_cast<int64_t>(static_cast<const object::Hash*>(args[0].object().get())->size()));
+    }
+    if (args[0].is(object::ObjectType::STRING_OBJ)) {
+        return Value::integer(static_cast<int64_t>(static_cast<const object::String*>(args[0].object().get())->size()));
+    }
+    auto array = arrayArgument(args, 0);
+    if (array == nullptr) return argumentError("len", "INT_ARRAY, STRING or HASH", args[0]);
+    return Value::integer(static_cast<int64_t>(array->elements.size()));
+}
+
+Value sum(const Value* args, size_t count) {
+    auto err = checkArgumentCount(count, 1);
+    if (!err.isNull()) return err;
+    auto array = arrayArgument(args, 0);
+    if (array == nullptr) return argumentError("sum", "INT_ARRAY", args[0]);
+    return Value::integer(simd::sum(array->elements.data(), array->elements.size()));
+}
+
+// min and max of an empty array are null
+Value min(const Value* args, size_t count) {
+    auto err = checkArgumentCount(count, 1);
+    if (!err.isNull()) return err;
+    auto array = arrayArgument(args, 0);
+    if (array == nullptr) return argumentError("min", "INT_ARRAY", args[0]);
+    if (array->elements.empty()) return Value::null();
+    return Value::integer(simd::min(array->elements.data(), array->elements.size()));
+}
+
+Value max(const Value* args, size_t count) {
+    auto err = checkArgumentCount(count, 1);
+    if (!err.isNull()) return err;
+    auto array = arrayArgument(args, 0);
+    if (array == nullptr) return argumentError("max", "INT_ARRAY", args[0]);
+    if (array->elements.empty()) return Value::null();
+    return Value::integer(simd::max(array->elements.data(), array->elements.size()));
+}
+
+Value dot(const Value* args, size_t count) {
+    auto err = checkArgumentCount(count, 2);
+    if (!err.isNull()) return err;
+    auto a = arrayArgument(args, 0);
+    if (a == nullptr) return argumentError("dot", "INT_ARRAY", args[0]);
+    auto b = arrayArgument(args, 1);
+    if (b == nullptr) return argumentError("dot", "INT_ARRAY", args[1]);
+    if (a->elements.size() != b->elements.size()) {
+        return error("array length mismatch: " + std::to_string(a->elements.size()) + " and " + std::to_string(b->elements.size()));
+    }
+    return Value::integer(simd::dot(a->elements.data(), b->elements.data(), a->elements.size()));
+}
+
+Value filterGt(const Value* args, size_t count) {
+    auto err = checkArgumentCount(count, 2);
+    if (!err.isNull()) return err;
+    auto array = arrayArgument(args, 0);
+    if (array == nullptr) return argumentError("filter_gt", "INT_ARRAY", args[0]);
+    if (!args[1].isInteger()) return argumentError("filter_gt", "INTEGER", args[1]);
+
+    auto result = allocator.array();
+    result->elements.resize(array->elements.size());
+    size_t kept = simd::filterGreater(array->elements.data(), array->elements.size(), args[1].integerValue(),
+                                      result->elements.data());
+    result->elements.resize(kept);
+    return result;
+}
+
+bool callable(const Value& value) {
+    return apply != nullptr && (value.is(object::ObjectType::FUNCTION_OBJ) || value.is(object::ObjectType::BUILTIN_OBJ));
+}
+
+// Runs body over chunks [0, chunks), on the thread pool if parallel.
+void runChunks(size_t chunks, bool parallel, const std::function<void(size_t)>& body) {
+    if (parallel) {
+        parallel::forEachChunk(chunks, body);
+        return;
+    }
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        body(chunk);
+    }
+}
+
+// map(arr, fn) and pmap(arr, fn): the array of fn(x) for each element. On
+// an error, the one for the lowest index is returned, as a sequential map
+// would.
+Value mapArray(const char* name, const Value* args, size_t count, bool parallel) {
+    auto err = checkArgumentCount(count, 2);
+    if (!err.isNull()) return err;
+    auto array = arrayArgument(args, 0);
+    if (array == nullptr) return argumentError(name, "INT_ARRAY", args[0]);
+    if (!callable(args[1])) return argumentError(name, "FUNCTION", args[1]);
+
+    const auto& elements = array->elements;
+    size_t n = elements.size();
+    size_t chunks = std::min(n, MAX_CHUNKS);
+    std::vector<Value> results(n);
+    runChunks(chunks, parallel, [&](size_t chunk) {
+        for (size_t i = chunk * n / chunks; i < (chunk + 1) * n / chunks; i++) {
+            Value element = Value::integer(elements[i]);
+            results[i] = apply(args[1], &element, 1);
+            if (!results[i].isInteger()) {
+                break; // the rest of the chunk is not needed
+            }
+        }
+    });
+
+    auto result = allocator.array();
+    result->elements.reserve(n);
+    for (const auto& value : results) {
+        if (value.is(object::ObjectType::ERROR_OBJ)) return value;
+        if (!value.isInteger()) {
+            return error(std::string("function passed to `") + name + "` must return INTEGER, got " + object::typeName(value.type()));
+        }
+        result->elements.push_back(value.integerValue());
+    }
+    return result;
+}
+
+Value map(const Value* args, size_t count) {
+    return mapArray("map", args, count, false);
+}
+
+Value pmap(const Value* args, size_t count) {
+    return mapArray("pmap", args, count, true);
+}
+
+// reduce(arr, fn, init) folds from the left: fn(...fn(fn(init, a0), a1)..., an).
+Value reduce(const Value* args, size_t count) {
+    auto err = checkArgumentCount(count, 3);
+    if (!err.isNull()) return err;
+    auto array = arrayArgument(args, 0);
+    if (array == nullptr) return argumentError("reduce", "INT_ARRAY", args[0]);
+    if (!callable(args[1])) return argumentError("reduce", "FUNCTION", args[1]);
+
+    Value pair[2] = {args[2], Value()};
+    for (int64_t element : array->elements) {
+        pair[1] = Value::integer(element);
+        pair[0] = apply(args[1], pair, 2);
+        if (pair[0].is(object::ObjectType::ERROR_OBJ)) return pair[0];
+    }
+    return pair[0];
+}
+
+// preduce(arr, fn, init) folds each chunk on its own, starting from its
+// first element, then folds the chunks' results into init in order. That
+// equals reduce when fn is associative.
+Value preduce(const Value* args, size_t count) {
+    auto err = checkArgumentCount(count, 3);
+    if (!err.isNull()) return err;
+    auto array = arrayArgument(args, 0);
+    if (array == nullptr) return argumentError("preduce", "INT_ARRAY", args[0]);
+    if (!callable(args[1])) return argumentError("preduce", "FUNCTION", args[1]);
+
+    const auto& elements = array->elements;
+    size_t n = elements.size();
+    size_t chunks = std::min(n, MAX_CHUNKS);
+    std::vector<Value> partials(chunks);
+    runChunks(chunks, true, [&](size_t chunk) {
+        size_t begin = chunk * n / chunks;
+        Value pair[2] = {Value::integer(elements[begin]), Value()};
+        for (size_t i = begin + 1; i < (chunk + 1) * n / chunks; i++) {
+            pair[1] = Value::integer(elements[i]);
+            pair[0] = apply(args[1], pair, 2);
+            if (pair[0].is(object::ObjectType::ERROR_OBJ)) break;
+        }
+        partials[chunk] = pair[0];
+    });
+
+    Value pair[2] = {args[2], Value()};
+    for (const auto& partial : partials) {
+        if (partial.is(object::ObjectType::ERROR_OBJ)) return partial;
+        pair[1] = partial;
+        pair[0] = apply(args[1], pair, 2);
+        if (pair[0].is(object::ObjectType::ERROR_OBJ)) return pair[0];
+    }
+    return pair[0];
+}
+
+struct Definition {
+    const char* name;
+    object::BuiltinFunction fn;
+};
+
+const Definition definitions[] = {
+    {"len", len},
+    {"sum", sum},
+    {"min", min},
+    {"max", max},
+    {"dot", dot},
+    {"filter_gt", filterGt},
+    {"map", map},
+    {"reduce", reduce},
+    {"pmap", pmap},
+    {"preduce", preduce},
+};
+
+constexpr int BUILTIN_COUNT = sizeof(definitions) / sizeof(definitions[0]);
+
+const std::vector<Value>& values() {
+    static const std::vector<Value> all = instantiate();
+    return all;
+}
+}
+
+std::vector<Value> instantiate() {
+    std::vector<Value> result;
+    for (const auto& def : definitions) {
+        result.push_back(Value(std::make_shared<object::Builtin>(def.name, def.fn)));
+    }
+    return result;
+}
+
+void setApplyFunction(ApplyFunction function) {
+    apply = function;
+}
+
+void setAllocator(Allocator newAllocator) {
+    allocator = newAllocator;
+}
+
+int indexOf(std::string_view name) {
+    for (int i = 0; i < BUILTIN_COUNT; i++) {
+        if (name == definitions[i].name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const Value& get(int index) {
+    return values()[index];
+}
+
+Value elementwise(char op, const Value& left, const Value& right) {
+    auto a = arrayArgument(&left, 0);
+    auto b = arrayArgument(&right, 0);
+    if (a == nullptr || b == nullptr || (op != '+' && op != '*')) {
+        return error("unknown operator: " + object::typeName(left.type()) + op + object::typeName(right.type()));
+    }
+    size_t n = a->elements.size();
+    if (b->elements.size() != n) {
+        return error("array length mismatch: " + std::to_string(n) + " and " + std::to_string(b->elements.size()));
+    }
+
+    auto result = allocator.array();
+    result->elements.resize(n);
+    if (op == '+') {
+        simd::add(a->elements.data(), b->elements.data(), result->elements.data(), n);
+    } else {
+        simd::mul(a->elements.data(), b->elements.data(), result->elements.data(), n);
+    }
+    return result;
+}
+
+}
\ No newline at end of file
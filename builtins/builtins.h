@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../object/object.h"
+
+namespace builtins {
+
+// The functions every program can call without defining them: len, sum,
+// min, max, dot, filter_gt, map, reduce, pmap and preduce. A global with
+// the same name shadows one. Both engines share them; the VM refers to
+// them by index.
+
+// Returns the index of the builtin with the given name, or -1.
+int indexOf(std::string_view name);
+// The builtin at an index returned by indexOf.
+const object::Value& get(int index);
+// New function objects for all builtins, in indexOf order. Each
+// evaluator::Context has its own, so threads do not share their
+// reference counts.
+std::vector<object::Value> instantiate();
+
+// Calls a function value. The higher-order builtins (map, reduce, pmap,
+// preduce) call their function argument through this; the evaluator
+// installs it. They do not accept the VM's closures.
+//
+// pmap and preduce call it from parallel::forEachChunk's pool threads, so
+// it must be safe to call concurrently.
+using ApplyFunction = object::Value (*)(const object::Value& fn, const object::Value* args, size_t count);
+void setApplyFunction(ApplyFunction function);
+
+// Makes the arrays and errors the builtins return, so they are accounted
+// for like the evaluator's own objects; the evaluator installs it (see
+// evaluator::allocate). Until then they are plain std::make_shared ones.
+//
+// Like ApplyFunction, it must be safe to call from the pool threads.
+struct Allocator {
+    std::shared_ptr<object::IntArray> (*array)();
+    std::shared_ptr<object::Error> (*error)(std::string message);
+};
+void setAllocator(Allocator allocator);
+
+// Elementwise `+` or `*` of two INT_ARRAYs of the same length. Returns an
+// Error for any other operands.
+object::Value elementwise(char op, const object::Value& left, const object::Value& right);
+
+}
\ No newline at end of file
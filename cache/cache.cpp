@@ -0,0 +1,572 @@
+#include "cache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cache {
+
+namespace {
+const char MAGIC[8] = {'M', 'O', 'N', 'K', 'E', 'Y', 'C', '\0'};
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304; // entries are only read back on the same kind of machine
+constexpr uint8_t NULL_NODE = 0xFF;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t sourceHash;
+    uint64_t sourceLength;
+    uint64_t payloadLength;
+    uint64_t payloadChecksum;
+};
+
+// 64-bit hash, eight bytes at a time. Used for the cache key and for the
+// checksum of an entry's node stream.
+uint64_t hashBytes(std::string_view bytes) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ bytes.size();
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes.data() + i, 8);
+        h = (h ^ word) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    if (i < bytes.size()) {
+        std::memcpy(&tail, bytes.data() + i, bytes.size() - i);
+    }
+    h = (h ^ tail) * 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 29);
+}
+
+std::string entryPath(const std::string& directory, uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.mkc", static_cast<unsigned long long>(key));
+    return directory + name;
+}
+
+bool isExpression(ast::NodeKind kind) {
+    switch (kind) {
+        case ast::NodeKind::IDENTIFIER:
+        case ast::NodeKind::INTEGER_LITERAL:
+        case ast::NodeKind::PREFIX_EXPRESSION:
+        case ast::NodeKind::INFIX_EXPRESSION:
+        case ast::NodeKind::BOOLEAN:
+        case ast::NodeKind::IF_EXPRESSION:
+        case ast::NodeKind::FUNCTION_LITERAL:
+        case ast::NodeKind::CALL_EXPRESSION:
+        case ast::NodeKind::ARRAY_LITERAL:
+        case ast::NodeKind::INDEX_EXPRESSION:
+        case ast::NodeKind::HASH_LITERAL:
+        case ast::NodeKind::STRING_LITERAL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// === Encoding ===
+// An entry's payload is a table of the distinct strings in the program
+// (names and string literals), then the program's statements. Each node is
+// its kind byte followed by its fields in declaration order. Children are
+// nodes, lists are a count followed by their nodes, strings are an index
+// into the table, operators are their ast::Operator byte, and a missing
+// child is NULL_NODE. Counts, lengths, indexes and integers are LEB128
+// varints, integers zigzag-encoded first.
+class Encoder {
+public:
+    std::string bytes;
+
+    // The string table followed by the statements.
+    std::string payload() const {
+        std::string result;
+        appendVarint(result, strings.size());
+        for (auto text : strings) {
+            appendVarint(result, text.size());
+        }
+        for (auto text : strings) {
+            result.append(text);
+        }
+        return result + bytes;
+    }
+
+    void node(const ast::Node* node) {
+        if (node == nullptr) {
+            u8(NULL_NODE);
+            return;
+        }
+        u8(static_cast<uint8_t>(node->kind));
+        switch (node->kind) {
+            case ast::NodeKind::PROGRAM:
+                break;
+            case ast::NodeKind::IDENTIFIER:
+                string(static_cast<const ast::Identifier*>(node)->value);
+                break;
+            case ast::NodeKind::LET_STATEMENT: {
+                auto let = static_cast<const ast::LetStatement*>(node);
+                this->node(let->name);
+                this->node(let->value);
+                break;
+            }
+            case ast::NodeKind::RETURN_STATEMENT:
+                this->node(static_cast<const ast::ReturnStatement*>(node)->returnValue);
+                break;
+            case ast::NodeKind::EXPRESSION_STATEMENT:
+                this->node(static_cast<const ast::ExpressionStatement*>(node)->expression);
+                break;
+            case ast::NodeKind::INTEGER_LITERAL: {
+                auto value = static_cast<const ast::IntegerLiteral*>(node)->value;
+                varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+                break;
+            }
+            case ast::NodeKind::PREFIX_EXPRESSION: {
+                auto prefix = static_cast<const ast::PrefixExpression*>(node);
+                u8(static_cast<uint8_t>(prefix->op));
+                this->node(prefix->right);
+                break;
+            }
+            case ast::NodeKind::INFIX_EXPRESSION: {
+                auto infix = static_cast<const ast::InfixExpression*>(node);
+                this->node(infix->left);
+                u8(static_cast<uint8_t>(infix->op));
+                this->node(infix->right);
+                break;
+            }
+            case ast::NodeKind::BOOLEAN:
+                u8(static_cast<const ast::Boolean*>(node)->value ? 1 : 0);
+                break;
+            case ast::NodeKind::BLOCK_STATEMENT:
+                list(static_cast<const ast::BlockStatement*>(node)->statements);
+                break;
+            case ast::NodeKind::IF_EXPRESSION: {
+                auto ie = static_cast<const ast::IfExpression*>(node);
+                this->node(ie->condition);
+                this->node(ie->consequence);
+                this->node(ie->alternative);
+                break;
+            }
+            case ast::NodeKind::FUNCTION_LITERAL: {
+                auto fn = static_cast<const ast::FunctionLiteral*>(node);
+                list(fn->parameters);
+                this->node(fn->body);
+                string(fn->name);
+                u8(fn->memoized ? 1 : 0);
+                break;
+            }
+            case ast::NodeKind::CALL_EXPRESSION: {
+                auto call = static_cast<const ast::CallExpression*>(node);
+                this->node(call->function);
+                list(call->arguments);
+                break;
+            }
+            case ast::NodeKind::ARRAY_LITERAL:
+                list(static_cast<const ast::ArrayLiteral*>(node)->elements);
+                break;
+            case ast::NodeKind::INDEX_EXPRESSION: {
+                auto indexExp = static_cast<const ast::IndexExpression*>(node);
+                this->node(indexExp->left);
+                this->node(indexExp->index);
+                break;
+            }
+            case ast::NodeKind::HASH_LITERAL:
+                list(static_cast<const ast::HashLiteral*>(node)->pairs);
+                break;
+            case ast::NodeKind::STRING_LITERAL:
+                string(static_cast<const ast::StringLiteral*>(node)->value);
+                break;
+        }
+    }
+
+    template <typename T>
+    void list(const ast::NodeList<T>& nodes) {
+        varint(nodes.size());
+        for (const auto n : nodes) {
+            node(n);
+        }
+    }
+
+    void u8(uint8_t value) { bytes += static_cast<char>(value); }
+    void varint(uint64_t value) { appendVarint(bytes, value); }
+
+    void string(std::string_view text) {
+        auto inserted = indexes.emplace(text, static_cast<uint32_t>(strings.size()));
+        if (inserted.second) {
+            strings.push_back(text);
+        }
+        varint(inserted.first->second);
+    }
+
+private:
+    static void appendVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out += static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    std::vector<std::string_view> strings; // views of the program's arena
+    std::unordered_map<std::string_view, uint32_t> indexes;
+};
+
+// === Decoding ===
+// Rebuilds the nodes in the program's arena the way the parser creates
+// them. Every read is bounds-checked and every child's kind is checked
+// against its field, so a bad entry fails to load rather than producing
+// a malformed tree.
+class Decoder {
+public:
+    Decoder(std::string_view bytes, ast::Program& program) : bytes(bytes), program(program) {}
+
+    bool failed = false;
+
+    // Copies the string table into the arena in one piece.
+    void readStrings() {
+        uint32_t count = u32();
+        if (failed || count > bytes.size() - pos) { // every length takes at least a byte
+            failed = true;
+            return;
+        }
+        std::vector<uint32_t> sizes(count);
+        size_t total = 0;
+        for (auto& size : sizes) {
+            size = u32();
+            total += size;
+        }
+        if (failed || total > bytes.size() - pos) {
+            failed = true;
+            return;
+        }
+        auto text = program.arena.copyString(bytes.substr(pos, total));
+        pos += total;
+        strings.reserve(count);
+        size_t offset = 0;
+        for (auto size : sizes) {
+            strings.push_back(text.substr(offset, size));
+            offset += size;
+        }
+    }
+
+    bool atEnd() const { return pos == bytes.size(); }
+
+    ast::Node* node() {
+        uint8_t kind = u8();
+        if (failed || kind == NULL_NODE) {
+            return nullptr;
+        }
+        auto& arena = program.arena;
+        switch (static_cast<ast::NodeKind>(kind)) {
+            case ast::NodeKind::IDENTIFIER:
+                return arena.make<ast::Identifier>(string());
+            case ast::NodeKind::LET_STATEMENT: {
+                auto name = identifier();
+                auto value = expression();
+                return name != nullptr ? arena.make<ast::LetStatement>(name, value) : fail();
+            }
+            case ast::NodeKind::RETURN_STATEMENT:
+                return arena.make<ast::ReturnStatement>(expression());
+            case ast::NodeKind::EXPRESSION_STATEMENT:
+                return arena.make<ast::ExpressionStatement>(expression());
+            case ast::NodeKind::INTEGER_LITERAL: {
+                uint64_t zigzag = varint();
+                return arena.make<ast::IntegerLiteral>(static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1));
+            }
+            case ast::NodeKind::PREFIX_EXPRESSION: {
+                ast::Operator op;
+                bool known = operatorCode(op);
+                auto right = expression();
+                return known && right != nullptr ? arena.make<ast::PrefixExpression>(op, right) : fail();
+            }
+            case ast::NodeKind::INFIX_EXPRESSION: {
+                auto left = expression();
+                ast::Operator op;
+                bool known = operatorCode(op);
+                auto right = expression();
+                return left != nullptr && known && right != nullptr ? arena.make<ast::InfixExpression>(left, op, right) : fail();
+            }
+            case ast::NodeKind::BOOLEAN:
+                return arena.make<ast::Boolean>(u8() != 0);
+            case ast::NodeKind::BLOCK_STATEMENT:
+                return arena.make<ast::BlockStatement>(statements());
+            case ast::NodeKind::IF_EXPRESSION: {
+                auto condition = expression();
+                auto consequence = block();
+                auto alternative = block();
+                return condition != nullptr && consequence != nullptr ? arena.make<ast::IfExpression>(condition, consequence, alternative) : fail();
+            }
+            case ast::NodeKind::FUNCTION_LITERAL: {
+                auto parameters = list<ast::Identifier>([this]() { return identifier(); });
+                auto body = block();
+                auto name = string();
+                bool memoized = u8() != 0;
+                if (body == nullptr) {
+                    return fail();
+                }
+                auto fn = arena.make<ast::FunctionLiteral>(parameters, body, &program);
+                fn->name = name;
+                fn->memoized = memoized;
+                return fn;
+            }
+            case ast::NodeKind::CALL_EXPRESSION: {
+                auto function = expression();
+                auto arguments = expressions();
+                return function != nullptr ? arena.make<ast::CallExpression>(function, arguments, program.newCallSite()) : fail();
+            }
+            case ast::NodeKind::ARRAY_LITERAL:
+                return arena.make<ast::ArrayLiteral>(expressions());
+            case ast::NodeKind::INDEX_EXPRESSION: {
+                auto left = expression();
+                auto index = expression();
+                return left != nullptr && index != nullptr ? arena.make<ast::IndexExpression>(left, index) : fail();
+            }
+            case ast::NodeKind::HASH_LITERAL: {
+                auto pairs = expressions();
+                return pairs.size() % 2 == 0 ? arena.make<ast::HashLiteral>(pairs) : fail();
+            }
+            case ast::NodeKind::STRING_LITERAL:
+                return arena.make<ast::StringLiteral>(string(), program.newConstant());
+            default:
+                return fail();
+        }
+    }
+
+    ast::NodeList<ast::Statement> statements() {
+        return list<ast::Statement>([this]() {
+            auto n = node();
+            return n == nullptr || isExpression(n->kind) ? static_cast<ast::Statement*>(fail()) : static_cast<ast::Statement*>(n);
+        });
+    }
+
+private:
+    ast::Node* fail() {
+        failed = true;
+        return nullptr;
+    }
+
+    // An expression, or nullptr for NULL_NODE.
+    ast::Expression* expression() {
+        auto n = node();
+        if (n != nullptr && !isExpression(n->kind)) {
+            return static_cast<ast::Expression*>(fail());
+        }
+        return static_cast<ast::Expression*>(n);
+    }
+
+    ast::Identifier* identifier() {
+        auto n = node();
+        return n != nullptr && n->kind == ast::NodeKind::IDENTIFIER ? static_cast<ast::Identifier*>(n) : static_cast<ast::Identifier*>(fail());
+    }
+
+    // A block, or nullptr for NULL_NODE.
+    ast::BlockStatement* block() {
+        auto n = node();
+        if (n != nullptr && n->kind != ast::NodeKind::BLOCK_STATEMENT) {
+            return static_cast<ast::BlockStatement*>(fail());
+        }
+        return static_cast<ast::BlockStatement*>(n);
+    }
+
+    ast::NodeList<ast::Expression> expressions() {
+        return list<ast::Expression>([this]() {
+            auto n = expression();
+            return n != nullptr ? n : static_cast<ast::Expression*>(fail());
+        });
+    }
+
+    template <typename T, typename Read>
+    ast::NodeList<T> list(Read read) {
+        uint32_t count = u32();
+        if (failed || count == 0) {
+            return ast::NodeList<T>();
+        }
+        if (count > bytes.size() - pos) { // every node takes at least a byte
+            fail();
+            return ast::NodeList<T>();
+        }
+        T** items = static_cast<T**>(program.arena.allocate(count * sizeof(T*), alignof(T*)));
+        for (uint32_t i = 0; i < count && !failed; i++) {
+            items[i] = read();
+        }
+        return failed ? ast::NodeList<T>() : ast::NodeList<T>(items, count);
+    }
+
+    bool take(void* out, size_t size) {
+        if (failed || size > bytes.size() - pos) {
+            failed = true;
+            return false;
+        }
+        std::memcpy(out, bytes.data() + pos, size);
+        pos += size;
+        return true;
+    }
+
+    uint8_t u8() {
+        uint8_t value = 0;
+        take(&value, sizeof(value));
+        return value;
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (failed || pos == bytes.size()) {
+                failed = true;
+                return 0;
+            }
+            uint8_t byte = static_cast<uint8_t>(bytes[pos++]);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        failed = true;
+        return 0;
+    }
+
+    uint32_t u32() {
+        uint64_t value = varint();
+        if (value > UINT32_MAX) {
+            failed = true;
+            return 0;
+        }
+        return static_cast<uint32_t>(value);
+    }
+
+    std::string_view string() {
+        uint32_t index = u32();
+        if (failed || index >= strings.size()) {
+            failed = true;
+            return std::string_view();
+        }
+        return strings[index];
+    }
+
+    // False for an unknown code.
+    bool operatorCode(ast::Operator& op) {
+        uint8_t code = u8();
+        op = static_cast<ast::Operator>(code);
+        return code < ast::OPERATOR_COUNT;
+    }
+
+    std::string_view bytes;
+    size_t pos = 0;
+    ast::Program& program;
+    std::vector<std::string_view> strings; // views of the program's arena
+};
+
+std::shared_ptr<ast::Program> decode(std::string_view entry, std::string_view source, uint64_t key) {
+    Header header;
+    if (entry.size() < sizeof(header)) {
+        return nullptr;
+    }
+    std::memcpy(&header, entry.data(), sizeof(header));
+    std::string_view payload = entry.substr(sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION
+        || header.byteOrder != BYTE_ORDER_MARK || header.sourceHash != key || header.sourceLength != source.size()
+        || header.payloadLength != payload.size() || header.payloadChecksum != hashBytes(payload)) {
+        return nullptr;
+    }
+
+    auto program = std::make_shared<ast::Program>();
+    Decoder decoder(payload, *program);
+    decoder.readStrings();
+    program->statements = decoder.statements();
+    if (decoder.failed || !decoder.atEnd()) {
+        return nullptr;
+    }
+    return program;
+}
+}
+
+uint64_t hashSource(std::string_view source) {
+    return hashBytes(source);
+}
+
+std::string encode(std::string_view source, const ast::Program& program) {
+    Encoder encoder;
+    encoder.list(program.statements);
+    std::string payload = encoder.payload();
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.sourceHash = hashSource(source);
+    header.sourceLength = source.size();
+    header.payloadLength = payload.size();
+    header.payloadChecksum = hashBytes(payload);
+    return std::string(reinterpret_cast<const char*>(&header), sizeof(header)) + payload;
+}
+
+std::shared_ptr<ast::Program> decode(std::string_view entry, std::string_view source) {
+    return decode(entry, source, hashSource(source));
+}
+
+std::shared_ptr<ast::Program> load(const std::string& directory, std::string_view source) {
+    uint64_t key = hashSource(source);
+    int fd = ::open(entryPath(directory, key).c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    std::shared_ptr<ast::Program> program;
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        size_t size = static_cast<size_t>(st.st_size);
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            program = decode(std::string_view(static_cast<const char*>(p), size), source, key);
+            ::munmap(p, size);
+        }
+    }
+    ::close(fd);
+    return program;
+}
+
+bool store(const std::string& directory, std::string_view source, const ast::Program& program, std::string& error) {
+    std::string entry = encode(source, program);
+
+    if (::mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST) {
+        error = std::strerror(errno);
+        return false;
+    }
+    std::string path = entryPath(directory, hashSource(source));
+    std::string temporary = path + ".tmp" + std::to_string(::getpid());
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+    std::string_view rest = entry;
+    bool written = true;
+    while (written && !rest.empty()) {
+        ssize_t n = ::write(fd, rest.data(), rest.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        written = n > 0;
+        if (written) {
+            rest.remove_prefix(static_cast<size_t>(n));
+        }
+    }
+    if (!written) {
+        error = std::strerror(errno);
+    }
+    ::close(fd);
+    if (written && ::rename(temporary.c_str(), path.c_str()) < 0) {
+        error = std::strerror(errno);
+        written = false;
+    }
+    if (!written) {
+        ::unlink(temporary.c_str());
+    }
+    return written;
+}
+
+}
\ No newline at end of file
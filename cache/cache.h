@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "../ast/ast.h"
+
+namespace cache {
+
+// An on-disk cache of parsed programs, so a script that has not changed
+// since the last run is loaded without lexing or parsing it again.
+//
+// Each entry is one file in the cache directory, named after a hash of
+// the source text. It holds the tree the parser produced, before
+// resolution or optimization, as a stream of nodes in preorder. The header
+// repeats the format version, the source hash and length, and a checksum
+// of the node stream. An entry whose header or checksum does not match is
+// a miss, so editing the source, upgrading the interpreter or a damaged
+// file all lead to a fresh parse, whose result replaces the entry.
+
+// Bump when the encoding or the information it carries changes.
+constexpr uint32_t FORMAT_VERSION = 1;
+
+// The key of a source text.
+uint64_t hashSource(std::string_view source);
+
+// The program previously stored for exactly this source, or nullptr.
+// The entry is memory-mapped and decoded straight into a new Program.
+std::shared_ptr<ast::Program> load(const std::string& directory, std::string_view source);
+
+// The bytes of the entry for a freshly parsed program: what store writes.
+std::string encode(std::string_view source, const ast::Program& program);
+
+// The program an entry holds, if it is intact and was encoded for exactly
+// this source by this FORMAT_VERSION, or nullptr.
+std::shared_ptr<ast::Program> decode(std::string_view entry, std::string_view source);
+
+// Stores a freshly parsed program for its source. The directory is
+// created if needed, and the entry is written to a temporary file and
+// renamed, so concurrent runs never see half of one. Returns false and
+// sets error if it could not be written.
+bool store(const std::string& directory, std::string_view source, const ast::Program& program, std::string& error);
+
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "code.h"
+
+#include <cstdio>
+
+namespace code {
+namespace {
+const Definition definitions[] = {
+    {"OpConstant", {2}},
+    {"OpPop", {}},
+    {"OpAdd", {}},
+    {"OpSub", {}},
+    {"OpMul", {}},
+    {"OpDiv", {}},
+    {"OpTrue", {}},
+    {"OpFalse", {}},
+    {"OpNull", {}},
+    {"OpEqual", {}},
+    {"OpNotEqual", {}},
+    {"OpGreaterThan", {}},
+    {"OpLessThan", {}},
+    {"OpMinus", {}},
+    {"OpBang", {}},
+    {"OpJumpNotTruthy", {2}},
+    {"OpJump", {2}},
+    {"OpGetGlobal", {2}},
+    {"OpSetGlobal", {2}},
+    {"OpGetLocal", {1}},
+    {"OpSetLocal", {1}},
+    {"OpGetFree", {1}},
+    {"OpCurrentClosure", {}},
+    {"OpClosure", {2, 1}},
+    {"OpCall", {1}},
+    {"OpReturnValue", {}},
+    {"OpArray", {2}},
+    {"OpIndex", {}},
+    {"OpGetBuiltin", {1}},
+    {"OpHash", {2}},
+    {"OpHashKey", {}},
+};
+}
+
+const Definition* lookup(Opcode op) {
+    auto index = static_cast<size_t>(op);
+    if (index >= sizeof(definitions) / sizeof(definitions[0])) {
+        return nullptr;
+    }
+    return &definitions[index];
+}
+
+Instructions make(Opcode op, const std::vector<int>& operands) {
+    const Definition* def = lookup(op);
+    if (def == nullptr) {
+        return {};
+    }
+
+    Instructions instruction;
+    instruction.push_back(static_cast<uint8_t>(op));
+    for (size_t i = 0; i < operands.size() && i < def->operandWidths.size(); i++) {
+        int operand = operands[i];
+        switch (def->operandWidths[i]) {
+            case 2:
+                instruction.push_back(static_cast<uint8_t>((operand >> 8) & 0xff));
+                instruction.push_back(static_cast<uint8_t>(operand & 0xff));
+                break;
+            case 1:
+                instruction.push_back(static_cast<uint8_t>(operand & 0xff));
+                break;
+        }
+    }
+    return instruction;
+}
+
+std::vector<int> readOperands(const Definition& def, const uint8_t* ins, int& bytesRead) {
+    std::vector<int> operands;
+    int offset = 0;
+
+    for (int width : def.operandWidths) {
+        switch (width) {
+            case 2:
+                operands.push_back(readUint16(ins + offset));
+                break;
+            case 1:
+                operands.push_back(readUint8(ins + offset));
+                break;
+        }
+        offset += width;
+    }
+    bytesRead = offset;
+    return operands;
+}
+
+std::string toString(const Instructions& ins) {
+    std::string result;
+
+    size_t i = 0;
+    while (i < ins.size()) {
+        const Definition* def = lookup(static_cast<Opcode>(ins[i]));
+        if (def == nullptr) {
+            result += "ERROR: unknown opcode " + std::to_string(ins[i]) + "\n";
+            i++;
+            continue;
+        }
+
+        int read = 0;
+        auto operands = readOperands(*def, ins.data() + i + 1, read);
+
+        char offset[24];
+        std::snprintf(offset, sizeof(offset), "%04zu", i);
+        result += std::string(offset) + " " + def->name;
+        for (int operand : operands) {
+            result += " " + std::to_string(operand);
+        }
+        result += "\n";
+
+        i += 1 + read;
+    }
+    return result;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace code {
+
+using Instructions = std::vector<uint8_t>;
+
+enum class Opcode : uint8_t {
+    OpConstant,
+    OpPop,
+
+    OpAdd,
+    OpSub,
+    OpMul,
+    OpDiv,
+
+    OpTrue,
+    OpFalse,
+    OpNull,
+
+    OpEqual,
+    OpNotEqual,
+    OpGreaterThan,
+    OpLessThan,
+
+    OpMinus,
+    OpBang,
+
+    OpJumpNotTruthy,
+    OpJump,
+
+    OpGetGlobal,
+    OpSetGlobal,
+    OpGetLocal,
+    OpSetLocal,
+    OpGetFree,
+    OpCurrentClosure,
+
+    OpClosure,
+    OpCall,
+    OpReturnValue,
+
+    OpArray,
+    OpIndex,
+    OpGetBuiltin,
+    OpHash,
+    OpHashKey,
+};
+
+struct Definition {
+    std::string name;
+    std::vector<int> operandWidths;
+};
+
+const Definition* lookup(Opcode op);
+
+Instructions make(Opcode op, const std::vector<int>& operands = {});
+std::vector<int> readOperands(const Definition& def, const uint8_t* ins, int& bytesRead);
+std::string toString(const Instructions& ins);
+
+inline uint16_t readUint16(const uint8_t* ins) {
+    return static_cast<uint16_t>((ins[0] << 8) | ins[1]);
+}
+
+inline uint8_t readUint8(const uint8_t* ins) {
+    return ins[0];
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,413 @@
+#include "compiler.h"
+
+#include "../builtins/builtins.h"
+
+namespace compiler {
+
+using code::Opcode;
+
+Compiler::Compiler() : Compiler(std::make_shared<SymbolTable>(), {}) {}
+
+Compiler::Compiler(std::shared_ptr<SymbolTable> symbolTable, std::vector<object::Value> constants)
+    : symbolTable(symbolTable), constants(constants) {
+    scopes.push_back(CompilationScope{});
+}
+
+bool Compiler::compile(std::shared_ptr<ast::Program> program) {
+    auto& stmts = program->statements;
+    for (const auto& stmt : stmts) {
+        declareGlobals(stmt);
+    }
+    if (symbolTable->numDefinitions > 0x10000) { // their indexes are 16-bit operands
+        return error("too many globals");
+    }
+    for (size_t i = 0; i < stmts.size(); i++) {
+        bool last = i == stmts.size() - 1;
+        if (!compileStatement(stmts[i], last)) {
+            return false;
+        }
+        // the value of the last statement is the result of the program
+        if (last && !endsWithReturn(stmts)) {
+            emit(Opcode::OpPop);
+        }
+    }
+    // addConstant reports overflow without stopping the compilation
+    return errorMessages.empty();
+}
+
+std::vector<std::string> Compiler::errors() const {
+    return errorMessages;
+}
+
+Bytecode Compiler::bytecode() const {
+    return Bytecode{scopes[scopeIndex].instructions, constants, symbolTable->names()};
+}
+
+// Defines the globals the program's lets bind before compiling any of it,
+// so a function can refer to a global bound after it, as in the evaluator.
+// Reading one before its let has run is an error at run time (see
+// OpGetGlobal). Lets inside function bodies bind locals and are skipped.
+void Compiler::declareGlobals(const ast::Node* node) {
+    if (node == nullptr) {
+        return;
+    }
+    switch (node->kind) {
+        case ast::NodeKind::LET_STATEMENT: {
+            auto let = static_cast<const ast::LetStatement*>(node);
+            declareGlobals(let->value);
+            symbolTable->define(std::string(let->name->value));
+            break;
+        }
+        case ast::NodeKind::RETURN_STATEMENT:
+            declareGlobals(static_cast<const ast::ReturnStatement*>(node)->returnValue);
+            break;
+        case ast::NodeKind::EXPRESSION_STATEMENT:
+            declareGlobals(static_cast<const ast::ExpressionStatement*>(node)->expression);
+            break;
+        case ast::NodeKind::BLOCK_STATEMENT:
+            for (const auto& stmt : static_cast<const ast::BlockStatement*>(node)->statements) {
+                declareGlobals(stmt);
+            }
+            break;
+        case ast::NodeKind::PREFIX_EXPRESSION:
+            declareGlobals(static_cast<const ast::PrefixExpression*>(node)->right);
+            break;
+        case ast::NodeKind::INFIX_EXPRESSION: {
+            auto infix = static_cast<const ast::InfixExpression*>(node);
+            declareGlobals(infix->left);
+            declareGlobals(infix->right);
+            break;
+        }
+        case ast::NodeKind::IF_EXPRESSION: {
+            auto ie = static_cast<const ast::IfExpression*>(node);
+            declareGlobals(ie->condition);
+            declareGlobals(ie->consequence);
+            declareGlobals(ie->alternative);
+            break;
+        }
+        case ast::NodeKind::CALL_EXPRESSION: {
+            auto call = static_cast<const ast::CallExpression*>(node);
+            declareGlobals(call->function);
+            for (const auto& arg : call->arguments) {
+                declareGlobals(arg);
+            }
+            break;
+        }
+        case ast::NodeKind::ARRAY_LITERAL:
+            for (const auto& element : static_cast<const ast::ArrayLiteral*>(node)->elements) {
+                declareGlobals(element);
+            }
+            break;
+        case ast::NodeKind::HASH_LITERAL:
+            for (const auto& part : static_cast<const ast::HashLiteral*>(node)->pairs) {
+                declareGlobals(part);
+            }
+            break;
+        case ast::NodeKind::INDEX_EXPRESSION: {
+            auto indexExp = static_cast<const ast::IndexExpression*>(node);
+            declareGlobals(indexExp->left);
+            declareGlobals(indexExp->index);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Compiles a statement. With keepValue set, the value the evaluator would
+// produce for the statement is left on the stack.
+bool Compiler::compileStatement(const ast::Statement* stmt, bool keepValue) {
+    switch (stmt->kind) {
+        case ast::NodeKind::EXPRESSION_STATEMENT:
+            if (!compileExpression(static_cast<const ast::ExpressionStatement*>(stmt)->expression)) return false;
+            if (!keepValue) emit(Opcode::OpPop);
+            return true;
+        case ast::NodeKind::LET_STATEMENT:
+            return compileLetStatement(static_cast<const ast::LetStatement*>(stmt), keepValue);
+        case ast::NodeKind::RETURN_STATEMENT:
+            if (!compileExpression(static_cast<const ast::ReturnStatement*>(stmt)->returnValue)) return false;
+            emit(Opcode::OpReturnValue);
+            return true;
+        case ast::NodeKind::BLOCK_STATEMENT:
+            if (!compileBlock(static_cast<const ast::BlockStatement*>(stmt))) return false;
+            if (!keepValue) emit(Opcode::OpPop);
+            return true;
+        default:
+            return error("unsupported statement: " + stmt->toString());
+    }
+}
+
+// Compiles a block so that its value is left on the stack.
+bool Compiler::compileBlock(const ast::BlockStatement* block) {
+    auto& stmts = block->statements;
+    if (stmts.empty()) {
+        emit(Opcode::OpNull);
+        return true;
+    }
+    for (size_t i = 0; i < stmts.size(); i++) {
+        if (!compileStatement(stmts[i], i == stmts.size() - 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Compiler::compileLetStatement(const ast::LetStatement* let, bool keepValue) {
+    // The name is bound after its value is compiled, so `let x = x + 1`
+    // reads the outer x just like the evaluator does. Recursive functions
+    // reach themselves through OpCurrentClosure instead.
+    if (!compileExpression(let->value)) return false;
+
+    const Symbol& symbol = symbolTable->define(std::string(let->name->value));
+    if (symbol.scope == SymbolScope::GLOBAL) {
+        emit(Opcode::OpSetGlobal, {symbol.index});
+    } else {
+        emit(Opcode::OpSetLocal, {symbol.index});
+    }
+    if (keepValue) {
+        loadSymbol(symbol);
+    }
+    return true;
+}
+
+bool Compiler::compileExpression(const ast::Expression* exp) {
+    if (exp == nullptr) {
+        return error("missing expression");
+    }
+
+    switch (exp->kind) {
+        case ast::NodeKind::INTEGER_LITERAL: {
+            auto value = static_cast<const ast::IntegerLiteral*>(exp)->value;
+            emit(Opcode::OpConstant, {addConstant(object::Value::integer(value))});
+            return true;
+        }
+        case ast::NodeKind::STRING_LITERAL: {
+            auto value = static_cast<const ast::StringLiteral*>(exp)->value;
+            emit(Opcode::OpConstant, {addConstant(object::intern(value))});
+            return true;
+        }
+        case ast::NodeKind::BOOLEAN:
+            emit(static_cast<const ast::Boolean*>(exp)->value ? Opcode::OpTrue : Opcode::OpFalse);
+            return true;
+        case ast::NodeKind::PREFIX_EXPRESSION:
+            return compilePrefixExpression(static_cast<const ast::PrefixExpression*>(exp));
+        case ast::NodeKind::INFIX_EXPRESSION:
+            return compileInfixExpression(static_cast<const ast::InfixExpression*>(exp));
+        case ast::NodeKind::IF_EXPRESSION:
+            return compileIfExpression(static_cast<const ast::IfExpression*>(exp));
+        case ast::NodeKind::IDENTIFIER: {
+            auto ident = static_cast<const ast::Identifier*>(exp);
+            const Symbol* symbol = symbolTable->resolve(std::string(ident->value));
+            if (symbol == nullptr) {
+                int builtin = builtins::indexOf(ident->value);
+                if (builtin >= 0) {
+                    emit(Opcode::OpGetBuiltin, {builtin});
+                    return true;
+                }
+                return error("identifier not found: " + std::string(ident->value));
+            }
+            loadSymbol(*symbol);
+            return true;
+        }
+        case ast::NodeKind::FUNCTION_LITERAL:
+            return compileFunctionLiteral(static_cast<const ast::FunctionLiteral*>(exp));
+        case ast::NodeKind::CALL_EXPRESSION: {
+            auto callExp = static_cast<const ast::CallExpression*>(exp);
+            if (!compileExpression(callExp->function)) return false;
+            for (const auto& arg : callExp->arguments) {
+                if (!compileExpression(arg)) return false;
+            }
+            emit(Opcode::OpCall, {static_cast<int>(callExp->arguments.size())});
+            return true;
+        }
+        case ast::NodeKind::ARRAY_LITERAL: {
+            auto array = static_cast<const ast::ArrayLiteral*>(exp);
+            if (array->elements.size() > 0xFFFF) {
+                return error("too many array elements");
+            }
+            for (const auto& element : array->elements) {
+                if (!compileExpression(element)) return false;
+            }
+            emit(Opcode::OpArray, {static_cast<int>(array->elements.size())});
+            return true;
+        }
+        case ast::NodeKind::HASH_LITERAL: {
+            auto hash = static_cast<const ast::HashLiteral*>(exp);
+            if (hash->pairs.size() > 0xFFFF) {
+                return error("too many hash pairs");
+            }
+            // each key is checked before its value is evaluated, as in the evaluator
+            for (size_t i = 0; i < hash->size(); i++) {
+                if (!compileExpression(hash->key(i))) return false;
+                emit(Opcode::OpHashKey);
+                if (!compileExpression(hash->value(i))) return false;
+            }
+            emit(Opcode::OpHash, {static_cast<int>(hash->pairs.size())});
+            return true;
+        }
+        case ast::NodeKind::INDEX_EXPRESSION: {
+            auto indexExp = static_cast<const ast::IndexExpression*>(exp);
+            if (!compileExpression(indexExp->left)) return false;
+            if (!compileExpression(indexExp->index)) return false;
+            emit(Opcode::OpIndex);
+            return true;
+        }
+        default:
+            return error("unsupported expression: " + exp->toString());
+    }
+}
+
+bool Compiler::compilePrefixExpression(const ast::PrefixExpression* prefix) {
+    if (!compileExpression(prefix->right)) return false;
+
+    switch (prefix->op) {
+        case ast::Operator::BANG: emit(Opcode::OpBang); break;
+        case ast::Operator::MINUS: emit(Opcode::OpMinus); break;
+        default: return error("unknown operator " + std::string(ast::operatorText(prefix->op)));
+    }
+    return true;
+}
+
+bool Compiler::compileInfixExpression(const ast::InfixExpression* infix) {
+    if (!compileExpression(infix->left)) return false;
+    if (!compileExpression(infix->right)) return false;
+
+    switch (infix->op) {
+        case ast::Operator::PLUS: emit(Opcode::OpAdd); break;
+        case ast::Operator::MINUS: emit(Opcode::OpSub); break;
+        case ast::Operator::ASTERISK: emit(Opcode::OpMul); break;
+        case ast::Operator::SLASH: emit(Opcode::OpDiv); break;
+        case ast::Operator::GT: emit(Opcode::OpGreaterThan); break;
+        case ast::Operator::LT: emit(Opcode::OpLessThan); break;
+        case ast::Operator::EQ: emit(Opcode::OpEqual); break;
+        case ast::Operator::NOT_EQ: emit(Opcode::OpNotEqual); break;
+        default: return error("unknown operator " + std::string(ast::operatorText(infix->op)));
+    }
+    return true;
+}
+
+bool Compiler::compileIfExpression(const ast::IfExpression* ie) {
+    if (!compileExpression(ie->condition)) return false;
+
+    // operands are patched once the jump targets are known
+    int jumpNotTruthyPos = emit(Opcode::OpJumpNotTruthy, {9999});
+    if (!compileBlock(ie->consequence)) return false;
+    int jumpPos = emit(Opcode::OpJump, {9999});
+
+    changeOperand(jumpNotTruthyPos, static_cast<int>(currentInstructions().size()));
+    if (ie->alternative != nullptr) {
+        if (!compileBlock(ie->alternative)) return false;
+    } else {
+        emit(Opcode::OpNull);
+    }
+    changeOperand(jumpPos, static_cast<int>(currentInstructions().size()));
+    return true;
+}
+
+bool Compiler::compileFunctionLiteral(const ast::FunctionLiteral* fn) {
+    enterScope();
+
+    if (!fn->name.empty()) {
+        symbolTable->defineFunctionName(std::string(fn->name));
+    }
+    for (const auto& param : fn->parameters) {
+        symbolTable->define(std::string(param->value));
+    }
+
+    if (!compileBlock(fn->body)) {
+        leaveScope();
+        return false;
+    }
+    if (!endsWithReturn(fn->body->statements)) {
+        emit(Opcode::OpReturnValue);
+    }
+
+    auto freeSymbols = symbolTable->freeSymbols;
+    int numLocals = symbolTable->numDefinitions;
+    auto instructions = leaveScope();
+
+    if (numLocals > 255) {
+        return error("too many local bindings in function");
+    }
+
+    for (const auto& s : freeSymbols) {
+        loadSymbol(s);
+    }
+
+    auto compiledFn = std::make_shared<object::CompiledFunction>(instructions, numLocals, static_cast<int>(fn->parameters.size()),
+                                                               object::inspectFunction(fn));
+    emit(Opcode::OpClosure, {addConstant(compiledFn), static_cast<int>(freeSymbols.size())});
+    return true;
+}
+
+int Compiler::addConstant(object::Value obj) {
+    constants.push_back(obj);
+    int index = static_cast<int>(constants.size()) - 1;
+    if (index == 0x10000) { // reported once, the first time the limit is passed
+        error("too many constants");
+    }
+    return index;
+}
+
+int Compiler::emit(Opcode op, const std::vector<int>& operands) {
+    auto ins = code::make(op, operands);
+    auto& current = currentInstructions();
+    int pos = static_cast<int>(current.size());
+    current.insert(current.end(), ins.begin(), ins.end());
+    return pos;
+}
+
+bool Compiler::endsWithReturn(const ast::NodeList<ast::Statement>& stmts) const {
+    // only a trailing return statement counts; an OpReturnValue emitted at
+    // the end of an if branch can still be jumped over by the other branch
+    return !stmts.empty() && stmts.back()->kind == ast::NodeKind::RETURN_STATEMENT;
+}
+
+void Compiler::changeOperand(int opPosition, int operand) {
+    auto& current = currentInstructions();
+    auto op = static_cast<Opcode>(current[opPosition]);
+    auto ins = code::make(op, {operand});
+    std::copy(ins.begin(), ins.end(), current.begin() + opPosition);
+}
+
+void Compiler::loadSymbol(const Symbol& symbol) {
+    switch (symbol.scope) {
+        case SymbolScope::GLOBAL:
+            emit(Opcode::OpGetGlobal, {symbol.index});
+            break;
+        case SymbolScope::LOCAL:
+            emit(Opcode::OpGetLocal, {symbol.index});
+            break;
+        case SymbolScope::FREE:
+            emit(Opcode::OpGetFree, {symbol.index});
+            break;
+        case SymbolScope::FUNCTION:
+            emit(Opcode::OpCurrentClosure);
+            break;
+    }
+}
+
+code::Instructions& Compiler::currentInstructions() {
+    return scopes[scopeIndex].instructions;
+}
+
+void Compiler::enterScope() {
+    scopes.push_back(CompilationScope{});
+    scopeIndex++;
+    symbolTable = std::make_shared<SymbolTable>(symbolTable);
+}
+
+code::Instructions Compiler::leaveScope() {
+    auto instructions = currentInstructions();
+    scopes.pop_back();
+    scopeIndex--;
+    symbolTable = symbolTable->outer;
+    return instructions;
+}
+
+bool Compiler::error(const std::string& msg) {
+    errorMessages.push_back(msg);
+    return false;
+}
+
+}
\ No newline at end of file
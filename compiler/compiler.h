@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "symbol_table.h"
+#include "../ast/ast.h"
+#include "../code/code.h"
+#include "../object/object.h"
+
+namespace compiler {
+
+struct CompilationScope {
+    code::Instructions instructions;
+};
+
+struct Bytecode {
+    code::Instructions instructions;
+    std::vector<object::Value> constants;
+    std::vector<std::string> globalNames; // by global index, for errors about unbound ones
+};
+
+class Compiler {
+public:
+    Compiler();
+    // Continues from the state of an earlier compilation, so a REPL can keep
+    // its globals and constants across lines.
+    Compiler(std::shared_ptr<SymbolTable> symbolTable, std::vector<object::Value> constants);
+
+    bool compile(std::shared_ptr<ast::Program> program);
+    std::vector<std::string> errors() const;
+    Bytecode bytecode() const;
+
+    std::shared_ptr<SymbolTable> symbolTable;
+    std::vector<object::Value> constants;
+
+private:
+    std::vector<CompilationScope> scopes;
+    int scopeIndex = 0;
+    std::vector<std::string> errorMessages;
+
+    void declareGlobals(const ast::Node* node);
+    bool compileStatement(const ast::Statement* stmt, bool keepValue);
+    bool compileBlock(const ast::BlockStatement* block);
+    bool compileExpression(const ast::Expression* exp);
+    bool compileLetStatement(const ast::LetStatement* let, bool keepValue);
+    bool compileIfExpression(const ast::IfExpression* ie);
+    bool compileFunctionLiteral(const ast::FunctionLiteral* fn);
+    bool compileInfixExpression(const ast::InfixExpression* infix);
+    bool compilePrefixExpression(const ast::PrefixExpression* prefix);
+
+    int addConstant(object::Value obj);
+    int emit(code::Opcode op, const std::vector<int>& operands = {});
+    bool endsWithReturn(const ast::NodeList<ast::Statement>& stmts) const;
+    void changeOperand(int opPosition, int operand);
+    void loadSymbol(const Symbol& symbol);
+
+    code::Instructions& currentInstructions();
+    void enterScope();
+    code::Instructions leaveScope();
+
+    bool error(const std::string& msg);
+};
+
+}
\ No newline at end of file
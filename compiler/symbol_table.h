@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+namespace compiler {
+
+enum class SymbolScope {
+    GLOBAL,
+    LOCAL,
+    FREE,
+    FUNCTION,
+};
+
+struct Symbol {
+    std::string name;
+    SymbolScope scope;
+    int index;
+};
+
+class SymbolTable {
+private:
+    std::unordered_map<std::string, Symbol> store;
+
+public:
+    std::shared_ptr<SymbolTable> outer;
+    std::vector<Symbol> freeSymbols;
+    int numDefinitions = 0;
+
+    SymbolTable() {}
+    explicit SymbolTable(std::shared_ptr<SymbolTable> outer) : outer(outer) {}
+
+    const Symbol& define(const std::string& name) {
+        auto it = store.find(name);
+        if (it != store.end() && it->second.scope != SymbolScope::FREE && it->second.scope != SymbolScope::FUNCTION) {
+            return it->second; // re-binding an existing name reuses its slot
+        }
+        SymbolScope scope = outer == nullptr ? SymbolScope::GLOBAL : SymbolScope::LOCAL;
+        Symbol symbol{name, scope, numDefinitions++};
+        return store[name] = symbol;
+    }
+
+    const Symbol& defineFunctionName(const std::string& name) {
+        Symbol symbol{name, SymbolScope::FUNCTION, 0};
+        return store[name] = symbol;
+    }
+
+    // The names of the slots define() handed out, by index.
+    std::vector<std::string> names() const {
+        std::vector<std::string> result(numDefinitions);
+        for (const auto& entry : store) {
+            if (entry.second.scope == SymbolScope::GLOBAL || entry.second.scope == SymbolScope::LOCAL) {
+                result[entry.second.index] = entry.first;
+            }
+        }
+        return result;
+    }
+
+    const Symbol* resolve(const std::string& name) {
+        auto it = store.find(name);
+        if (it != store.end()) {
+            return &it->second;
+        }
+        if (outer == nullptr) {
+            return nullptr;
+        }
+
+        const Symbol* symbol = outer->resolve(name);
+        if (symbol == nullptr || symbol->scope == SymbolScope::GLOBAL) {
+            return symbol;
+        }
+        return &defineFree(*symbol);
+    }
+
+private:
+    const Symbol& defineFree(const Symbol& original) {
+        freeSymbols.push_back(original);
+        Symbol symbol{original.name, SymbolScope::FREE, static_cast<int>(freeSymbols.size()) - 1};
+        return store[original.name] = symbol;
+    }
+};
+
+}
\ No newline at end of file
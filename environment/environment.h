@@ -2,42 +2,98 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include <unordered_map>
+#include "../gc/gc.h"
 #include "../object/object.h"
 
 namespace object {
 
-class Environment {
+// A scope's bindings, stored in slots assigned by resolver::Resolver.
+// Function frames are fixed-size; the outermost (global) environment also
+// keeps a name -> slot table so it can grow and be searched by name.
+// Environments are always owned by shared_ptrs; the collector relies on
+// their use counts.
+class Environment : public gc::Collectable, public std::enable_shared_from_this<Environment> {
 private:
-    std::unordered_map<std::string, std::shared_ptr<Object>> store;
+    std::vector<Value> slots;
     std::shared_ptr<Environment> outer;
-    
+    std::unordered_map<std::string, int> names;
+
 public:
-    Environment() {};
-    explicit Environment(std::shared_ptr<Environment> outerEnv) : outer(outerEnv) {}
-
-    std::shared_ptr<Object> get(std::string name) {
-        if (store.find(name) != store.end()) {
-            return store[name];
-        } else if (outer != nullptr) {
-            return outer->get(name);
-        } else {
-            return nullptr;
+    Environment() : gc::Collectable(gc::Kind::ENVIRONMENT) {};
+    Environment(std::shared_ptr<Environment> outerEnv, size_t size)
+        : gc::Collectable(gc::Kind::ENVIRONMENT), slots(size, Value::undefined()), outer(outerEnv) {}
+
+    // Returns nullptr if the slot has not been bound yet.
+    const Value* get(int depth, int slot) const {
+        const Environment* env = this;
+        for (; depth > 0; depth--) {
+            env = env->outer.get();
         }
+        const Value& val = env->slots[slot];
+        return val.isUndefined() ? nullptr : &val;
     }
 
-    std::shared_ptr<Object> set(std::string &name, std::shared_ptr<Object> val) {
-        store[name] = val;
+    Value set(int slot, Value val) {
+        slots[slot] = val;
         return val;
     }
+
+    // Turns the environment into a fresh, unbound frame of the given size,
+    // keeping its storage. Only valid when nothing else refers to it.
+    void reset(std::shared_ptr<Environment> outerEnv, size_t size) {
+        outer = std::move(outerEnv);
+        slots.assign(size, Value::undefined());
+    }
+
+    // === Globals table ===
+    // Returns the slot of a global name, adding an unbound one if needed.
+    int define(const std::string& name) {
+        auto it = names.find(name);
+        if (it != names.end()) {
+            return it->second;
+        }
+        int slot = static_cast<int>(slots.size());
+        slots.push_back(Value::undefined());
+        names.emplace(name, slot);
+        return slot;
+    }
+
+    // Returns the slot of a global name, or -1 if it has never been defined.
+    int slotOf(const std::string& name) const {
+        auto it = names.find(name);
+        return it != names.end() ? it->second : -1;
+    }
+
+    // Looks a name up in the globals table of the outermost environment.
+    const Value* getGlobal(const std::string& name) const {
+        const Environment* env = this;
+        while (env->outer != nullptr) {
+            env = env->outer.get();
+        }
+        int slot = env->slotOf(name);
+        return slot >= 0 ? env->get(0, slot) : nullptr;
+    }
+
+    // === Collector support (gc::Heap) ===
+    const std::shared_ptr<Environment>& enclosing() const { return outer; }
+    const std::vector<Value>& bindings() const { return slots; }
+
+    // Drops every reference the environment holds, to break a garbage cycle.
+    void clear() {
+        slots.clear();
+        names.clear();
+        outer.reset();
+    }
 };
 
 inline std::shared_ptr<Environment> newEnvironment() {
     return std::make_shared<Environment>();
 }
 
-inline std::shared_ptr<Environment> newEnclosedEnvironment(std::shared_ptr<Environment> outer) {
-    return std::make_shared<Environment>(outer);
+inline std::shared_ptr<Environment> newEnclosedEnvironment(std::shared_ptr<Environment> outer, size_t size) {
+    return std::make_shared<Environment>(outer, size);
 }
 
 }
\ No newline at end of file
@@ -4,213 +4,642 @@
 #include <vector>
 #include <iostream>
 #include <sstream>
+#include <utility>
+#include <type_traits>
+#include "../builtins/builtins.h"
+#include "../gc/gc.h"
+#include "../parallel/parallel.h"
+#include "../profiler/profiler.h"
+#include "../stats/stats.h"
 
 namespace evaluator {
 
 using object::Object;
+using object::Value;
 using object::Environment;
-using object::Integer;
-using object::Boolean;
-using object::Null;
-using object::ReturnValue;
 using object::Error;
 using object::Function;
+using object::IntArray;
+using object::Hash;
+using object::String;
+using object::Builtin;
 
-static std::shared_ptr<Boolean> TRUE = std::make_shared<Boolean>(true);
-static std::shared_ptr<Boolean> FALSE = std::make_shared<Boolean>(false);
-static std::shared_ptr<Null> NULL_OBJ = std::make_shared<Null>();
-
-std::shared_ptr<Object> eval(std::shared_ptr<ast::Node> node, std::shared_ptr<Environment> env) {
-    if (auto program = std::dynamic_pointer_cast<ast::Program>(node)) {
-        return evalProgram(program->statements, env);
-    } else if (auto stmt = std::dynamic_pointer_cast<ast::ExpressionStatement>(node)) {
-        return eval(stmt->expression, env);
-    } else if (auto intLit = std::dynamic_pointer_cast<ast::IntegerLiteral>(node)) {
-        return std::make_shared<Integer>(intLit->value);
-    } else if (auto boolLit = std::dynamic_pointer_cast<ast::Boolean>(node)) {
-        return nativeBoolToBooleanObject(boolLit->value);
-    } else if (auto prefix = std::dynamic_pointer_cast<ast::PrefixExpression>(node)) {
-        auto right = eval(prefix->right, env);
-        if (isError(right)) {
-            return right;
-        }
-        return evalPrefixExpression(prefix->op, right);
-    } else if (auto infix = std::dynamic_pointer_cast<ast::InfixExpression>(node)) {
-        auto left = eval(infix->left, env);
-        if (isError(left)) {
-            return left;
-        }
-        auto right = eval(infix->right, env);
-        if (isError(right)) {
-            return right;
-        }
-        return evalInfixExpression(infix->op, left, right);
-    } else if (auto ifExp = std::dynamic_pointer_cast<ast::IfExpression>(node)) {
-        return evalIfExpression(ifExp, env);
-    } else if (auto blockStmt = std::dynamic_pointer_cast<ast::BlockStatement>(node)) {
-        return evalBlockStatement(blockStmt, env);
-    } else if (auto returnStmt = std::dynamic_pointer_cast<ast::ReturnStatement>(node)) {
-        auto val = eval(returnStmt->returnValue, env);
-        if (isError(val)) return val;
-        return std::make_shared<ReturnValue>(val);
-    } else if (auto letStmt = std::dynamic_pointer_cast<ast::LetStatement>(node)) {
-        auto val = eval(letStmt->value, env);
-        if (isError(val)) return val;
-        env->set(letStmt->name->value, val);
-        return val;
-    } else if (auto ident = std::dynamic_pointer_cast<ast::Identifier>(node)) {
-        return evalIdentifier(ident, env);
-    } else if (auto funcLit = std::dynamic_pointer_cast<ast::FunctionLiteral>(node)) {
-        auto params = funcLit->parameters;
-        auto body = funcLit->body;
-        return std::make_shared<Function>(params, body, env);
-    } else if (auto callExp = std::dynamic_pointer_cast<ast::CallExpression>(node)) {
-        auto function = eval(callExp->function, env);
-        if (isError(function)) return function;
-        auto args = evalExpressions(callExp->arguments, env);
-        if (args.size() == 1 && isError(args[0])) return args[0];
-        return applyFunction(function, args);
-    } else {
-        return nullptr;
+using Status = Completion::Status;
+
+namespace {
+// Per thread, since pmap and preduce evaluate on several.
+thread_local uint64_t evaluatedNodes = 0;
+thread_local Context* activeContext = nullptr; // see context()
+
+// The message of the error being propagated while its Completion carries
+// no object::Error yet. Nothing is evaluated between fail() and the
+// boundary that materializes it, so one per thread is enough.
+thread_local std::string pendingError;
+
+// Arguments of calls in tail position. A call pushes its arguments and
+// returns a TAIL_CALL completion; the runFunction it unwinds to takes
+// everything above the mark it set, and pops it.
+thread_local std::vector<Value> tailArguments;
+
+// String::concat's factory for the strings it creates.
+struct AllocateString {
+    template <typename... Args>
+    std::shared_ptr<String> operator()(Args&&... args) const {
+        return allocate<String>(std::forward<Args>(args)...);
+    }
+};
+
+Completion fail(std::string message) {
+    pendingError = std::move(message);
+    return Completion(Status::ERROR, Value::null());
+}
+
+// The value of a completion leaving the evaluator: the object::Error of a
+// failure is made here, the first time anything can see it.
+Value materialize(Completion completion) {
+    if (completion.status == Status::ERROR && !completion.value.isObject()) {
+        return allocate<Error>(std::move(pendingError));
+    }
+    return std::move(completion.value);
+}
+
+// A builtin's result. An error it returned keeps propagating as one.
+Completion fromBuiltin(Value result) {
+    if (isError(result)) {
+        return Completion(Status::ERROR, std::move(result));
+    }
+    return result;
+}
+
+// Two integer operands, the case evaluation spends most of its time in:
+// one switch on the operator and no type checks beyond the tags.
+Completion integerInfix(ast::Operator op, int64_t left, int64_t right) {
+    switch (op) {
+        case ast::Operator::PLUS: return Value::integer(object::wrappingAdd(left, right));
+        case ast::Operator::MINUS: return Value::integer(object::wrappingSubtract(left, right));
+        case ast::Operator::ASTERISK: return Value::integer(object::wrappingMultiply(left, right));
+        case ast::Operator::SLASH:
+            if (right == 0) {
+                return fail("division by zero");
+            }
+            return Value::integer(object::wrappingDivide(left, right));
+        case ast::Operator::LT: return Value::boolean(left < right);
+        case ast::Operator::GT: return Value::boolean(left > right);
+        case ast::Operator::EQ: return Value::boolean(left == right);
+        case ast::Operator::NOT_EQ: return Value::boolean(left != right);
+        case ast::Operator::BANG: break;
     }
+    return fail("unknown operator: INTEGER" + std::string(ast::operatorText(op)) + "INTEGER");
 }
 
-std::shared_ptr<Object> evalProgram(std::vector<std::shared_ptr<ast::Statement>> stmts, std::shared_ptr<Environment> env) {
-    std::shared_ptr<Object> result;
+// Call frames parked by pool threads (see callCached).
+constexpr size_t MAX_SPARE_FRAMES = 64;
+thread_local std::vector<std::shared_ptr<Environment>> spareFrames;
 
-    for (auto stmt : stmts) {
-        result = eval(stmt, env);
-        if (result && result->type() == object::ObjectType::RETURN_VALUE_OBJ) {
-            return std::dynamic_pointer_cast<ReturnValue>(result)->value;
-        } else if (result && result->type() == object::ObjectType::ERROR_OBJ) {
+// Calls to memo functions in one tail call chain whose results are not
+// cached yet. They all get the value the chain ends with.
+struct PendingMemo {
+    std::shared_ptr<Function> function; // keeps the table alive
+    object::MemoTable::Key key;
+};
+
+void storeMemo(std::vector<PendingMemo>& pending, const Value& result) {
+    for (auto& call : pending) {
+        if (call.function->memo->insert(std::move(call.key), result)) {
+            context().memo.evictions++;
+        }
+    }
+}
+
+// Runs a function in a frame whose parameters are already bound, then the
+// calls in tail position it ends with, reusing the frame when no closure
+// captured it. Calls in tail position come back as TAIL_CALL completions
+// instead of being applied recursively, so tail-recursive functions use
+// constant C++ stack. Returns a NORMAL or an ERROR completion.
+Completion runFunction(std::shared_ptr<Function> function, std::shared_ptr<Environment>& frame) {
+    std::vector<PendingMemo> pending;
+    size_t mark = tailArguments.size();
+    while (true) {
+        if (function->memo != nullptr && !parallel::onPoolThread()) {
+            object::MemoTable::Key key;
+            if (object::MemoTable::makeKey(frame->bindings().data(), function->literal->parameters.size(), key)) {
+                if (const Value* cached = function->memo->find(key)) {
+                    context().memo.hits++;
+                    Value result = *cached;
+                    storeMemo(pending, result);
+                    return result;
+                }
+                context().memo.misses++;
+                pending.push_back(PendingMemo{function, std::move(key)});
+            }
+        }
+        if (profiler::active != nullptr) {
+            profiler::active->enter(*function);
+        }
+        auto completion = evalBlockStatement(function->literal->body, frame);
+        if (profiler::active != nullptr) {
+            profiler::active->exit();
+        }
+        if (completion.status == Status::ERROR) {
+            return completion;
+        }
+        if (completion.status != Status::TAIL_CALL) {
+            storeMemo(pending, completion.value);
+            return std::move(completion.value);
+        }
+
+        const Value& callee = completion.value;
+        size_t count = tailArguments.size() - mark;
+        if (callee.is(object::ObjectType::BUILTIN_OBJ)) {
+            // copied out, since the builtin may call back into the evaluator
+            std::vector<Value> arguments(std::make_move_iterator(tailArguments.begin() + mark), std::make_move_iterator(tailArguments.end()));
+            tailArguments.resize(mark);
+            auto result = fromBuiltin(static_cast<const Builtin*>(callee.object().get())->fn(arguments.data(), arguments.size()));
+            if (result.normal()) {
+                storeMemo(pending, result.value);
+            }
             return result;
         }
+        if (!callee.is(object::ObjectType::FUNCTION_OBJ)) {
+            tailArguments.resize(mark);
+            return fail("not a function: " + object::objectTypeToString(callee.type()));
+        }
+        function = std::static_pointer_cast<Function>(callee.object());
+        size_t parameters = function->literal->parameters.size();
+        if (count != parameters) {
+            tailArguments.resize(mark);
+            return fail("wrong number of arguments: want=" + std::to_string(parameters) + ", got=" + std::to_string(count));
+        }
+
+        if (frame.use_count() == 1) {
+            frame->reset(function->env, function->literal->frameSize);
+        } else {
+            frame = allocate<Environment>(function->env, function->literal->frameSize);
+        }
+        // parameters occupy the first slots of the frame
+        for (size_t i = 0; i < count; i++) {
+            frame->set(static_cast<int>(i), std::move(tailArguments[mark + i]));
+        }
+        tailArguments.resize(mark);
+    }
+}
+
+// A call whose callee is known to be a function taking as many arguments
+// as the site passes. The arguments are evaluated straight into the new
+// frame, which comes from the site's cache when the site called the same
+// function before and that call's frame was not captured by a closure.
+//
+// Pool threads must not touch the caches, which belong to the thread that
+// runs the program. They keep a few spare frames of their own instead.
+Completion callCached(const ast::CallExpression* call, std::shared_ptr<Function> function, const std::shared_ptr<Environment>& env) {
+    ast::CallSiteCache& cache = *call->cache;
+    auto literal = function->literal;
+    bool pooled = parallel::onPoolThread();
+    std::shared_ptr<Environment> frame;
+    if (pooled) {
+        if (!spareFrames.empty()) {
+            frame = std::move(spareFrames.back());
+            spareFrames.pop_back();
+            frame->reset(function->env, literal->frameSize);
+        } else {
+            frame = allocate<Environment>(function->env, literal->frameSize);
+        }
+    } else if (cache.literal == literal && cache.frame != nullptr) {
+        context().callSites.hits++;
+        frame = std::static_pointer_cast<Environment>(std::move(cache.frame));
+        cache.frame = nullptr;
+        frame->reset(function->env, literal->frameSize);
+    } else {
+        context().callSites.misses++;
+        cache.literal = literal;
+        frame = allocate<Environment>(function->env, literal->frameSize);
+    }
+
+    for (size_t i = 0; i < call->arguments.size(); i++) {
+        auto evaluated = evalNode(call->arguments[i], env);
+        if (!evaluated.normal()) return evaluated;
+        frame->set(static_cast<int>(i), std::move(evaluated.value));
+    }
+
+    auto result = runFunction(std::move(function), frame);
+
+    // parked empty, so a cached frame keeps nothing alive
+    if (frame.use_count() == 1) {
+        if (pooled) {
+            if (spareFrames.size() < MAX_SPARE_FRAMES) {
+                frame->reset(nullptr, 0);
+                spareFrames.push_back(std::move(frame));
+            }
+        } else if (cache.frame == nullptr) {
+            frame->reset(nullptr, 0);
+            cache.frame = std::move(frame);
+        }
     }
     return result;
 }
 
-std::shared_ptr<Boolean> nativeBoolToBooleanObject(bool input) {
-    if (input) {
-        return TRUE;
+// A call in tail position: pushes its arguments for the runFunction the
+// TAIL_CALL completion unwinds to.
+Completion tailCall(const ast::CallExpression* call, Value callee, const std::shared_ptr<Environment>& env) {
+    size_t mark = tailArguments.size();
+    for (size_t i = 0; i < call->arguments.size(); i++) {
+        auto evaluated = evalNode(call->arguments[i], env);
+        if (!evaluated.normal()) {
+            // A TAIL_CALL out of an argument, e.g. one in a `return` in an
+            // if, has pushed its own arguments above ours.
+            tailArguments.erase(tailArguments.begin() + mark, tailArguments.begin() + mark + i);
+            return evaluated;
+        }
+        tailArguments.push_back(std::move(evaluated.value));
     }
-    return FALSE;
+    return Completion(Status::TAIL_CALL, std::move(callee));
 }
 
-bool isError(std::shared_ptr<Object> obj) {
-    if (obj != nullptr) {
-        return obj->type() == object::ObjectType::ERROR_OBJ;
+// Calls a function value with evaluated arguments.
+Completion callValue(const Value& fn, const std::vector<Value>& args) {
+    if (fn.is(object::ObjectType::BUILTIN_OBJ)) {
+        return fromBuiltin(static_cast<const Builtin*>(fn.object().get())->fn(args.data(), args.size()));
     }
-    return false;
+    if (!fn.is(object::ObjectType::FUNCTION_OBJ)) {
+        return fail("not a function: " + object::objectTypeToString(fn.type()));
+    }
+    auto function = std::static_pointer_cast<Function>(fn.object());
+    auto& parameters = function->literal->parameters;
+    if (args.size() != parameters.size()) {
+        return fail("wrong number of arguments: want=" + std::to_string(parameters.size()) + ", got=" + std::to_string(args.size()));
+    }
+    auto frame = extendFunctionEnv(function, args);
+    return runFunction(std::move(function), frame);
 }
 
-std::shared_ptr<Object> evalPrefixExpression(std::string op, std::shared_ptr<Object> right) {
-    if (op == "!") {
-        if (right == FALSE) {
-            return TRUE;
-        } else {
-            return FALSE;
+// The statements of a program; a `return` ends it with its value.
+Completion evalStatements(const ast::NodeList<ast::Statement>& stmts, const std::shared_ptr<Environment>& env) {
+    Completion result(Value::null());
+    for (const auto& stmt : stmts) {
+        result = evalNode(stmt, env);
+        if (result.status == Status::RETURN) {
+            return std::move(result.value);
+        }
+        if (!result.normal()) {
+            return result;
+        }
+    }
+    return result;
+}
+
+// How the higher-order builtins call functions; installed before main runs.
+// A pool thread drops its spare frames afterwards, so none of them is left
+// on its heap when the caller adopts it.
+Value applyFromBuiltin(const Value& fn, const Value* args, size_t count) {
+    auto result = applyFunction(fn, std::vector<Value>(args, args + count));
+    if (parallel::onPoolThread()) {
+        spareFrames.clear();
+    }
+    return result;
+}
+
+[[maybe_unused]] const bool applyInstalled = (builtins::setApplyFunction(applyFromBuiltin), true);
+[[maybe_unused]] const bool allocatorInstalled = (builtins::setAllocator({
+    [] { return allocate<IntArray>(); },
+    [](std::string message) { return allocate<Error>(std::move(message)); },
+}), true);
+}
+
+Value eval(const ast::Node* node, const std::shared_ptr<Environment>& env) {
+    return materialize(evalNode(node, env));
+}
+
+Value evalProgram(const ast::NodeList<ast::Statement>& stmts, const std::shared_ptr<Environment>& env) {
+    return materialize(evalStatements(stmts, env));
+}
+
+Value applyFunction(const Value& fn, const std::vector<Value>& args) {
+    return materialize(callValue(fn, args));
+}
+
+Completion evalNode(const ast::Node* node, const std::shared_ptr<Environment>& env) {
+    evaluatedNodes++;
+    switch (node->kind) {
+        case ast::NodeKind::PROGRAM:
+            return evalStatements(static_cast<const ast::Program*>(node)->statements, env);
+        case ast::NodeKind::EXPRESSION_STATEMENT:
+            return evalNode(static_cast<const ast::ExpressionStatement*>(node)->expression, env);
+        case ast::NodeKind::INTEGER_LITERAL:
+            return Value::integer(static_cast<const ast::IntegerLiteral*>(node)->value);
+        case ast::NodeKind::STRING_LITERAL: {
+            auto literal = static_cast<const ast::StringLiteral*>(node);
+            if (literal->constant->object != nullptr) {
+                return Value(std::static_pointer_cast<String>(literal->constant->object));
+            }
+            return Value(object::intern(literal->value));
+        }
+        case ast::NodeKind::BOOLEAN:
+            return nativeBoolToBooleanObject(static_cast<const ast::Boolean*>(node)->value);
+        case ast::NodeKind::PREFIX_EXPRESSION: {
+            auto prefix = static_cast<const ast::PrefixExpression*>(node);
+            auto right = evalNode(prefix->right, env);
+            if (!right.normal()) {
+                return right;
+            }
+            return evalPrefixExpression(prefix->op, right.value);
         }
-    } else if (op == "-") {
-        if (right->type() != object::ObjectType::INTEGER_OBJ) {
-            return std::make_shared<Error>("unknown operator: -" + object::objectTypeToString(right->type()));
+        case ast::NodeKind::INFIX_EXPRESSION: {
+            auto infix = static_cast<const ast::InfixExpression*>(node);
+            auto left = evalNode(infix->left, env);
+            if (!left.normal()) {
+                return left;
+            }
+            Value right;
+            if (infix->right->kind == ast::NodeKind::INTEGER_LITERAL) {
+                // read in place, as in `n - 1`, rather than evaluated as a node
+                evaluatedNodes++;
+                right = Value::integer(static_cast<const ast::IntegerLiteral*>(infix->right)->value);
+            } else {
+                auto evaluated = evalNode(infix->right, env);
+                if (!evaluated.normal()) {
+                    return evaluated;
+                }
+                right = std::move(evaluated.value);
+            }
+            if (left.value.isInteger() && right.isInteger()) {
+                return integerInfix(infix->op, left.value.integerValue(), right.integerValue());
+            }
+            return evalInfixExpression(infix->op, left.value, right);
+        }
+        case ast::NodeKind::IF_EXPRESSION:
+            return evalIfExpression(static_cast<const ast::IfExpression*>(node), env);
+        case ast::NodeKind::BLOCK_STATEMENT:
+            return evalBlockStatement(static_cast<const ast::BlockStatement*>(node), env);
+        case ast::NodeKind::RETURN_STATEMENT: {
+            auto val = evalNode(static_cast<const ast::ReturnStatement*>(node)->returnValue, env);
+            if (!val.normal()) return val;
+            return Completion(Status::RETURN, std::move(val.value));
+        }
+        case ast::NodeKind::LET_STATEMENT: {
+            auto letStmt = static_cast<const ast::LetStatement*>(node);
+            auto val = evalNode(letStmt->value, env);
+            if (!val.normal()) return val;
+            int slot = letStmt->name->slot;
+            if (slot < 0) {
+                slot = env->define(std::string(letStmt->name->value)); // unresolved program, bind by name
+            }
+            env->set(slot, val.value);
+            return val;
+        }
+        case ast::NodeKind::IDENTIFIER:
+            return evalIdentifier(static_cast<const ast::Identifier*>(node), env);
+        case ast::NodeKind::FUNCTION_LITERAL: {
+            auto funcLit = static_cast<const ast::FunctionLiteral*>(node);
+            auto function = allocate<Function>(funcLit, funcLit->program->shared_from_this(), env);
+            if (funcLit->memoized) {
+                function->memo = std::make_unique<object::MemoTable>(context().memoCapacity);
+            }
+            return Value(std::move(function));
+        }
+        case ast::NodeKind::ARRAY_LITERAL:
+            return evalArrayLiteral(static_cast<const ast::ArrayLiteral*>(node), env);
+        case ast::NodeKind::HASH_LITERAL:
+            return evalHashLiteral(static_cast<const ast::HashLiteral*>(node), env);
+        case ast::NodeKind::INDEX_EXPRESSION: {
+            auto indexExp = static_cast<const ast::IndexExpression*>(node);
+            auto left = evalNode(indexExp->left, env);
+            if (!left.normal()) return left;
+            auto index = evalNode(indexExp->index, env);
+            if (!index.normal()) return index;
+            return evalIndexExpression(left.value, index.value);
+        }
+        case ast::NodeKind::CALL_EXPRESSION: {
+            auto callExp = static_cast<const ast::CallExpression*>(node);
+            auto function = evalNode(callExp->function, env);
+            if (!function.normal()) return function;
+            if (callExp->tail) {
+                // applied by the runFunction loop we are running in
+                return tailCall(callExp, std::move(function.value), env);
+            }
+            if (function.value.is(object::ObjectType::FUNCTION_OBJ)) {
+                auto fn = std::static_pointer_cast<Function>(function.value.object());
+                if (fn->literal->parameters.size() == callExp->arguments.size()) {
+                    return callCached(callExp, std::move(fn), env);
+                }
+            }
+            std::vector<Value> args;
+            auto evaluated = evalExpressions(callExp->arguments, env, args);
+            if (!evaluated.normal()) return evaluated;
+            return callValue(function.value, args);
         }
-        auto value = std::static_pointer_cast<Integer>(right)->value;
-	    return std::make_shared<Integer>(-value);
     }
-    return std::make_shared<Error>("unknown operator: " + op + object::objectTypeToString(right->type()));
+    return Value::null();
+}
+
+Value nativeBoolToBooleanObject(bool input) {
+    return Value::boolean(input);
+}
+
+bool isError(const Value& obj) {
+    return obj.is(object::ObjectType::ERROR_OBJ);
 }
 
-std::shared_ptr<Object> evalInfixExpression(std::string op, std::shared_ptr<Object> left, std::shared_ptr<Object> right) {
-    if (left->type() == object::ObjectType::INTEGER_OBJ && right->type() == object::ObjectType::INTEGER_OBJ) {
-        auto leftVal = std::static_pointer_cast<Integer>(left)->value;
-        auto rightVal = std::static_pointer_cast<Integer>(right)->value;
+Completion evalPrefixExpression(ast::Operator op, const Value& right) {
+    switch (op) {
+        case ast::Operator::BANG:
+            return Value::boolean(right.isBoolean() && !right.booleanValue());
+        case ast::Operator::MINUS:
+            if (!right.isInteger()) {
+                return fail("unknown operator: -" + object::objectTypeToString(right.type()));
+            }
+            return Value::integer(object::wrappingNegate(right.integerValue()));
+        default:
+            return fail("unknown operator: " + std::string(ast::operatorText(op)) + object::objectTypeToString(right.type()));
+    }
+}
 
-        if (op == "+") return std::make_shared<Integer>(leftVal + rightVal);
-        if (op == "-") return std::make_shared<Integer>(leftVal - rightVal);
-        if (op == "*") return std::make_shared<Integer>(leftVal * rightVal);
-        if (op == "/") return std::make_shared<Integer>(leftVal / rightVal);
-        if (op == "<") return nativeBoolToBooleanObject(leftVal < rightVal);
-        if (op == ">") return nativeBoolToBooleanObject(leftVal > rightVal);
+Completion evalInfixExpression(ast::Operator op, const Value& left, const Value& right) {
+    if (left.isInteger() && right.isInteger()) {
+        return integerInfix(op, left.integerValue(), right.integerValue());
+    }
+    switch (op) {
+        case ast::Operator::PLUS:
+        case ast::Operator::ASTERISK:
+            if (left.is(object::ObjectType::INT_ARRAY_OBJ) && right.is(object::ObjectType::INT_ARRAY_OBJ)) {
+                return fromBuiltin(builtins::elementwise(op == ast::Operator::PLUS ? '+' : '*', left, right));
+            }
+            if (op == ast::Operator::PLUS && left.is(object::ObjectType::STRING_OBJ) && right.is(object::ObjectType::STRING_OBJ)) {
+                return Value(String::concat(std::static_pointer_cast<String>(left.object()), std::static_pointer_cast<String>(right.object()), AllocateString()));
+            }
+            break;
+        case ast::Operator::EQ:
+            return nativeBoolToBooleanObject(left == right);
+        case ast::Operator::NOT_EQ:
+            return nativeBoolToBooleanObject(left != right);
+        default:
+            break;
     }
-    if (op == "==") return nativeBoolToBooleanObject(left == right);
-    if (op == "!=") return nativeBoolToBooleanObject(left != right);
-    if (left->type() != right->type()) return std::make_shared<Error>("type mismatch: " + object::objectTypeToString(left->type()) + " " + op + " " + object::objectTypeToString(left->type()));
-    return std::make_shared<Error>("unknown operator: " + object::objectTypeToString(left->type()) + op + object::objectTypeToString(right->type()));
+    std::string text(ast::operatorText(op));
+    if (left.type() != right.type()) return fail("type mismatch: " + object::objectTypeToString(left.type()) + " " + text + " " + object::objectTypeToString(right.type()));
+    return fail("unknown operator: " + object::objectTypeToString(left.type()) + text + object::objectTypeToString(right.type()));
 }
 
-std::shared_ptr<Object> evalIfExpression(std::shared_ptr<ast::IfExpression> ie, std::shared_ptr<Environment> env) {
-    auto condition = eval(ie->condition, env);
-    if (isError(condition)) return condition;
-    if (isTruthy(condition)) return eval(ie->consequence, env);
-    else if (ie->alternative != nullptr) return eval(ie->alternative, env);
-    else return NULL_OBJ;
+Completion evalIfExpression(const ast::IfExpression* ie, const std::shared_ptr<Environment>& env) {
+    auto condition = evalNode(ie->condition, env);
+    if (!condition.normal()) return condition;
+    if (isTruthy(condition.value)) return evalBlockStatement(ie->consequence, env);
+    else if (ie->alternative != nullptr) return evalBlockStatement(ie->alternative, env);
+    else return Value::null();
 }
 
-bool isTruthy(std::shared_ptr<Object> obj) {
-    if (obj == NULL_OBJ || obj == FALSE) return false;
-    if (obj == TRUE) return true;
+bool isTruthy(const Value& obj) {
+    if (obj.isNull()) return false;
+    if (obj.isBoolean()) return obj.booleanValue();
     return true;
 }
 
-std::shared_ptr<Object> evalBlockStatement(std::shared_ptr<ast::BlockStatement> block, std::shared_ptr<Environment> env) {
-    std::shared_ptr<Object> result;
+Completion evalBlockStatement(const ast::BlockStatement* block, const std::shared_ptr<Environment>& env) {
+    Completion result(Value::null());
 
     for (const auto& stmt : block->statements) {
-        result = eval(stmt, env);
-
-        if (result != nullptr) {
-            auto rt = result->type();
-            if (rt == object::ObjectType::RETURN_VALUE_OBJ || rt == object::ObjectType::ERROR_OBJ) {
-                return result;
-            }
+        result = evalNode(stmt, env);
+        if (!result.normal()) {
+            return result;
         }
     }
     return result;
 }
 
-std::shared_ptr<Object> evalIdentifier(std::shared_ptr<ast::Identifier> node, std::shared_ptr<Environment> env) {
-    auto val = env->get(node->value);
+Completion evalIdentifier(const ast::Identifier* node, const std::shared_ptr<Environment>& env) {
+    const Value* val = node->slot >= 0 ? env->get(node->depth, node->slot) : env->getGlobal(std::string(node->value));
     if (val) {
-        return val;
+        return *val;
+    }
+    if (node->slot >= 0) {
+        // not bound yet: read the binding it shadows, as a search by name would
+        for (auto outer = node->shadowed; outer != nullptr; outer = outer->shadowed) {
+            if ((val = env->get(outer->depth, outer->slot)) != nullptr) {
+                return *val;
+            }
+        }
+        if ((val = env->getGlobal(std::string(node->value))) != nullptr) {
+            return *val;
+        }
     }
-    return std::make_shared<Error>("identifier not found: " + node->value);
+    int builtin = builtins::indexOf(node->value);
+    if (builtin >= 0) {
+        return context().builtins[builtin];
+    }
+    return fail("identifier not found: " + std::string(node->value));
 }
 
-std::vector<std::shared_ptr<Object>> evalExpressions(std::vector<std::shared_ptr<ast::Expression>> exps, std::shared_ptr<Environment> env) {
-    std::vector<std::shared_ptr<Object>> result;
-
-    for (auto e : exps) {
-        auto evaluated = eval(e, env);
-        if (isError(evaluated)) return {evaluated};
-        result.push_back(evaluated);
+Completion evalArrayLiteral(const ast::ArrayLiteral* array, const std::shared_ptr<Environment>& env) {
+    auto result = allocate<IntArray>();
+    result->elements.reserve(array->elements.size());
+    for (const auto& e : array->elements) {
+        auto evaluated = evalNode(e, env);
+        if (!evaluated.normal()) return evaluated;
+        if (!evaluated.value.isInteger()) {
+            return fail("array elements must be INTEGER, got " + object::objectTypeToString(evaluated.value.type()));
+        }
+        result->elements.push_back(evaluated.value.integerValue());
     }
-    return result;
+    return Value(std::move(result));
 }
 
-std::shared_ptr<Object> applyFunction(std::shared_ptr<Object> fn, std::vector<std::shared_ptr<Object>> args) {
-    auto function = std::dynamic_pointer_cast<Function>(fn);
-    if (!function) {
-        return std::make_shared<Error>("not a function: " + object::objectTypeToString(fn->type()));
+Completion evalHashLiteral(const ast::HashLiteral* hash, const std::shared_ptr<Environment>& env) {
+    auto result = allocate<Hash>();
+    result->reserve(hash->size());
+    for (size_t i = 0; i < hash->size(); i++) {
+        auto key = evalNode(hash->key(i), env);
+        if (!key.normal()) return key;
+        if (!Hash::hashable(key.value)) {
+            return fail("unusable as hash key: " + object::objectTypeToString(key.value.type()));
+        }
+        auto value = evalNode(hash->value(i), env);
+        if (!value.normal()) return value;
+        result->set(key.value, std::move(value.value));
     }
-    auto extendedEnv = extendFunctionEnv(function, args);
-    auto evaluated = eval(function->body, extendedEnv);
-    return unwrapReturnValue(evaluated);
+    return Value(std::move(result));
 }
 
-std::shared_ptr<Environment> extendFunctionEnv(std::shared_ptr<Function> fn, std::vector<std::shared_ptr<Object>> args) {
-    auto env = object::newEnclosedEnvironment(fn->env);
+// Out of range indexes and missing keys give null.
+Completion evalIndexExpression(const Value& left, const Value& index) {
+    if (left.is(object::ObjectType::HASH_OBJ)) {
+        if (!Hash::hashable(index)) {
+            return fail("unusable as hash key: " + object::objectTypeToString(index.type()));
+        }
+        const Value* value = static_cast<const Hash*>(left.object().get())->get(index);
+        return value != nullptr ? *value : Value::null();
+    }
+    if (left.is(object::ObjectType::STRING_OBJ) && index.isInteger()) {
+        const auto& text = static_cast<const String*>(left.object().get())->flat();
+        int64_t i = index.integerValue();
+        if (i < 0 || i >= static_cast<int64_t>(text.size())) {
+            return Value::null();
+        }
+        std::string_view c(&text[i], 1);
+        return Value(String::identifierLike(c) ? object::intern(c) : allocate<String>(std::string(c)));
+    }
+    if (!left.is(object::ObjectType::INT_ARRAY_OBJ) || !index.isInteger()) {
+        return fail("index operator not supported: " + object::objectTypeToString(left.type()) + "[" + object::objectTypeToString(index.type()) + "]");
+    }
+    const auto& elements = static_cast<const IntArray*>(left.object().get())->elements;
+    int64_t i = index.integerValue();
+    if (i < 0 || i >= static_cast<int64_t>(elements.size())) {
+        return Value::null();
+    }
+    return Value::integer(elements[i]);
+}
 
-    for (int i=0;i<fn->parameters.size();i++) {
-        env->set(fn->parameters[i]->value, args[i]);
+Completion evalExpressions(const ast::NodeList<ast::Expression>& exps, const std::shared_ptr<Environment>& env, std::vector<Value>& values) {
+    values.reserve(exps.size());
+    for (const auto& e : exps) {
+        auto evaluated = evalNode(e, env);
+        if (!evaluated.normal()) return evaluated;
+        values.push_back(std::move(evaluated.value));
     }
+    return Value::null();
+}
+
+std::shared_ptr<Environment> extendFunctionEnv(const std::shared_ptr<Function>& fn, const std::vector<Value>& args) {
+    auto env = allocate<Environment>(fn->env, fn->literal->frameSize);
+    bindArguments(env, fn, args);
     return env;
 }
 
-std::shared_ptr<Object> unwrapReturnValue(std::shared_ptr<Object> obj) {
-    if (obj->type() == object::ObjectType::RETURN_VALUE_OBJ) {
-        return std::dynamic_pointer_cast<ReturnValue>(obj)->value;
+void bindArguments(const std::shared_ptr<Environment>& env, const std::shared_ptr<Function>& fn, const std::vector<Value>& args) {
+    // parameters occupy the first slots of the frame
+    for (size_t i=0;i<fn->literal->parameters.size();i++) {
+        env->set(static_cast<int>(i), args[i]);
+    }
+}
+
+uint64_t evaluatedNodeCount() {
+    return evaluatedNodes;
+}
+
+CallSiteStats callSiteStats() {
+    return context().callSites;
+}
+
+MemoStats memoStats() {
+    return context().memo;
+}
+
+void setMemoCapacity(size_t results) {
+    context().memoCapacity = results;
+}
+
+Context::Context() : builtins(builtins::instantiate()) {}
+
+Context& context() {
+    if (activeContext == nullptr) {
+        thread_local Context own;
+        activeContext = &own;
     }
-    return obj;
+    return *activeContext;
+}
+
+Context* setContext(Context* context) {
+    Context* previous = activeContext;
+    activeContext = context;
+    return previous;
 }
 
 }
\ No newline at end of file
@@ -1,26 +1,163 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include "../ast/ast.h"
 #include "../environment/environment.h"
+#include "../gc/gc.h"
 #include "../object/object.h"
+#include "../profiler/profiler.h"
+#include "../stats/stats.h"
 
 namespace evaluator {
 
-std::shared_ptr<object::Object> eval(std::shared_ptr<ast::Node> node, std::shared_ptr<object::Environment> env);
-std::shared_ptr<object::Object> evalProgram(std::vector<std::shared_ptr<ast::Statement>> stmts, std::shared_ptr<object::Environment> env);
-std::shared_ptr<object::Boolean> nativeBoolToBooleanObject(bool input);
-bool isError(std::shared_ptr<object::Object> obj);
-std::shared_ptr<object::Object> evalPrefixExpression(std::string op, std::shared_ptr<object::Object> right);
-std::shared_ptr<object::Object> evalInfixExpression(std::string op, std::shared_ptr<object::Object> left, std::shared_ptr<object::Object> right);
-std::shared_ptr<object::Object> evalIfExpression(std::shared_ptr<ast::IfExpression> ie, std::shared_ptr<object::Environment> env);
-bool isTruthy(std::shared_ptr<object::Object> obj);
-std::shared_ptr<object::Object> evalBlockStatement(std::shared_ptr<ast::BlockStatement> block, std::shared_ptr<object::Environment> env);
-std::shared_ptr<object::Object> evalIdentifier(std::shared_ptr<ast::Identifier> node, std::shared_ptr<object::Environment> env);
-std::vector<std::shared_ptr<object::Object>> evalExpressions(std::vector<std::shared_ptr<ast::Expression>> exps, std::shared_ptr<object::Environment> env);
-std::shared_ptr<object::Object> applyFunction(std::shared_ptr<object::Object> fn, std::vector<std::shared_ptr<object::Object>> args);
-std::shared_ptr<object::Environment> extendFunctionEnv(std::shared_ptr<object::Function> fn, std::vector<std::shared_ptr<object::Object>> args);
-std::shared_ptr<object::Object> unwrapReturnValue(std::shared_ptr<object::Object> obj);
+// === Completion ===
+// How evaluating a node ended. Anything but NORMAL unwinds to the
+// statement list, function call or program that handles it, so returns
+// and errors travel as plain values instead of heap objects:
+//
+// - RETURN: a `return` with its value, consumed by the enclosing call or
+//   the program.
+// - TAIL_CALL: a call in tail position whose callee is the value; its
+//   arguments are on the evaluator's tail call stack. Only the enclosing
+//   call's loop sees it (see applyFunction).
+// - ERROR: the value is an object::Error when one already exists, e.g. one
+//   a builtin returned, and null otherwise. Then only the message has been
+//   kept, and the object::Error is made once the error leaves the
+//   evaluator (see eval, evalProgram and applyFunction).
+struct Completion {
+    enum class Status : uint8_t {
+        NORMAL,
+        RETURN,
+        TAIL_CALL,
+        ERROR,
+    };
+
+    Status status;
+    object::Value value;
+
+    Completion(object::Value value) : status(Status::NORMAL), value(std::move(value)) {}
+    Completion(Status status, object::Value value) : status(status), value(std::move(value)) {}
+
+    bool normal() const { return status == Status::NORMAL; }
+};
+
+// === Allocation ===
+// An object allocated for a program, counted in stats::current() when
+// it is created and when it is freed. The type is asked for again in the
+// destructor rather than stored, so accounting costs no space.
+template <typename T>
+class Accounted final : public T {
+public:
+    template <typename... Args>
+    explicit Accounted(Args&&... args) : T(std::forward<Args>(args)...) {
+        if constexpr (std::is_same<T, object::Environment>::value) {
+            stats::current().environmentAllocated();
+        } else {
+            stats::current().allocated(this->type());
+        }
+    }
+
+    ~Accounted() {
+        if constexpr (std::is_same<T, object::Environment>::value) {
+            stats::current().environmentFreed();
+        } else {
+            stats::current().freed(this->type());
+        }
+    }
+};
+
+// Heap objects created for a program go through here, by the evaluator,
+// the builtins (see builtins::setAllocator) and the batch runner: the one
+// place they are accounted for, in the statistics and by the profiler,
+// which charges them to the function that is running. Allocating an object that
+// can form cycles is also where the collector gets to run.
+template <typename T, typename... Args>
+std::shared_ptr<T> allocate(Args&&... args) {
+    if (profiler::active != nullptr) {
+        profiler::active->allocation();
+    }
+    if constexpr (std::is_base_of<gc::Collectable, T>::value) {
+        gc::current().maybeCollect();
+    }
+    return std::make_shared<Accounted<T>>(std::forward<Args>(args)...);
+}
+
+// === Evaluation ===
+// Evaluate a node or a program and return its value, or the object::Error
+// it failed with.
+object::Value eval(const ast::Node* node, const std::shared_ptr<object::Environment>& env);
+inline object::Value eval(const std::shared_ptr<ast::Node>& node, const std::shared_ptr<object::Environment>& env) {
+    return eval(node.get(), env);
+}
+object::Value evalProgram(const ast::NodeList<ast::Statement>& stmts, const std::shared_ptr<object::Environment>& env);
+// Calls a function or builtin, as the higher-order builtins do.
+object::Value applyFunction(const object::Value& fn, const std::vector<object::Value>& args);
+
+// The steps of evaluation, which leave errors unmaterialized.
+Completion evalNode(const ast::Node* node, const std::shared_ptr<object::Environment>& env);
+object::Value nativeBoolToBooleanObject(bool input);
+bool isError(const object::Value& obj);
+Completion evalPrefixExpression(ast::Operator op, const object::Value& right);
+Completion evalInfixExpression(ast::Operator op, const object::Value& left, const object::Value& right);
+Completion evalIfExpression(const ast::IfExpression* ie, const std::shared_ptr<object::Environment>& env);
+bool isTruthy(const object::Value& obj);
+Completion evalBlockStatement(const ast::BlockStatement* block, const std::shared_ptr<object::Environment>& env);
+Completion evalIdentifier(const ast::Identifier* node, const std::shared_ptr<object::Environment>& env);
+Completion evalArrayLiteral(const ast::ArrayLiteral* array, const std::shared_ptr<object::Environment>& env);
+Completion evalHashLiteral(const ast::HashLiteral* hash, const std::shared_ptr<object::Environment>& env);
+Completion evalIndexExpression(const object::Value& left, const object::Value& index);
+Completion evalExpressions(const ast::NodeList<ast::Expression>& exps, const std::shared_ptr<object::Environment>& env, std::vector<object::Value>& values);
+std::shared_ptr<object::Environment> extendFunctionEnv(const std::shared_ptr<object::Function>& fn, const std::vector<object::Value>& args);
+void bindArguments(const std::shared_ptr<object::Environment>& env, const std::shared_ptr<object::Function>& fn, const std::vector<object::Value>& args);
+
+// Number of AST nodes evaluated so far, used by the benchmark to report
+// evaluation throughput.
+uint64_t evaluatedNodeCount();
+
+// Lookups in the call site caches (see ast::CallSiteCache). A hit reuses
+// the frame of the site's previous call.
+struct CallSiteStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+CallSiteStats callSiteStats();
+
+// Calls to `memo fn` functions: hits are answered from the function's
+// object::MemoTable, misses run the body and store the result.
+struct MemoStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+MemoStats memoStats();
+
+// Results each memo function keeps, applied to functions created afterwards.
+constexpr size_t DEFAULT_MEMO_CAPACITY = 10000;
+void setMemoCapacity(size_t results);
+
+// What evaluation keeps besides programs and environments: the statistics
+// and settings above and the builtin function objects. Every thread has a
+// context of its own, which an isolate::Isolate replaces with its own
+// while it runs, so threads never write to the same counters or reference
+// counts. The functions above use the calling thread's context.
+struct Context {
+    Context();
+
+    CallSiteStats callSites;
+    MemoStats memo;
+    size_t memoCapacity = DEFAULT_MEMO_CAPACITY;
+    std::vector<object::Value> builtins; // see builtins::instantiate
+};
+
+// The calling thread's context.
+Context& context();
+// Makes `context` the calling thread's context and returns the previous
+// one. nullptr goes back to the thread's own.
+Context* setContext(Context* context);
 
 }
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "gc.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "../environment/environment.h"
+#include "../object/object.h"
+
+namespace gc {
+
+thread_local Heap heap;
+thread_local Heap* active = nullptr;
+
+namespace {
+using object::Environment;
+using object::Function;
+using object::Hash;
+
+Environment* asEnvironment(Collectable* object) {
+    return static_cast<Environment*>(object);
+}
+
+Function* asFunction(Collectable* object) {
+    return static_cast<Function*>(object);
+}
+
+Hash* asHash(Collectable* object) {
+    return static_cast<Hash*>(object);
+}
+
+// Number of shared_ptrs owning the object. An object that is not owned by
+// a shared_ptr at all is something the collector cannot account for, so
+// it is reported as externally referenced.
+int64_t useCount(Collectable* object) {
+    long count = 0;
+    switch (object->kind) {
+        case Kind::ENVIRONMENT: count = asEnvironment(object)->weak_from_this().use_count(); break;
+        case Kind::FUNCTION: count = asFunction(object)->weak_from_this().use_count(); break;
+        case Kind::HASH: count = asHash(object)->weak_from_this().use_count(); break;
+    }
+    return count > 0 ? count : INT32_MAX;
+}
+
+// Calls visit with the collectable object a value refers to, if any.
+template <typename Visit>
+void visitValue(const object::Value& value, Visit& visit) {
+    if (value.is(object::ObjectType::FUNCTION_OBJ)) {
+        visit(static_cast<Function*>(value.object().get()));
+    } else if (value.is(object::ObjectType::HASH_OBJ)) {
+        visit(static_cast<Hash*>(value.object().get()));
+    }
+}
+
+// Calls visit with every collectable object this object holds a
+// reference to.
+template <typename Visit>
+void forEachReference(Collectable* object, Visit visit) {
+    switch (object->kind) {
+        case Kind::ENVIRONMENT: {
+            auto env = asEnvironment(object);
+            if (env->enclosing() != nullptr) {
+                visit(env->enclosing().get());
+            }
+            for (const auto& value : env->bindings()) {
+                visitValue(value, visit);
+            }
+            break;
+        }
+        case Kind::FUNCTION: {
+            auto fn = asFunction(object);
+            if (fn->env != nullptr) {
+                visit(fn->env.get());
+            }
+            if (fn->memo != nullptr) {
+                fn->memo->forEachValue([&visit](const object::Value& value) { visitValue(value, visit); });
+            }
+            break;
+        }
+        case Kind::HASH: {
+            for (const auto& entry : asHash(object)->items()) {
+                visitValue(entry.value, visit); // keys are never collectable
+            }
+            break;
+        }
+    }
+}
+}
+
+size_t Heap::collect() {
+    if (collecting) {
+        return 0;
+    }
+    collecting = true;
+    auto start = std::chrono::steady_clock::now();
+
+    // 1. Count the references each object has, then take away the ones
+    // held by other tracked objects. What is left was taken outside the
+    // heap, so a positive count marks a root.
+    for (Collectable* c = head; c != nullptr; c = c->next) {
+        c->gcRefs = useCount(c);
+        c->reachable = false;
+    }
+    // References into other heaps are left alone: those objects are not
+    // this thread's to count or collect.
+    for (Collectable* c = head; c != nullptr; c = c->next) {
+        forEachReference(c, [this](Collectable* referent) {
+            if (referent->owner == this) {
+                referent->gcRefs--;
+            }
+        });
+    }
+
+    // 2. Mark everything the roots reach.
+    std::vector<Collectable*> pending;
+    for (Collectable* c = head; c != nullptr; c = c->next) {
+        if (c->gcRefs > 0) {
+            c->reachable = true;
+            pending.push_back(c);
+        }
+    }
+    while (!pending.empty()) {
+        Collectable* c = pending.back();
+        pending.pop_back();
+        forEachReference(c, [this, &pending](Collectable* referent) {
+            if (referent->owner == this && !referent->reachable) {
+                referent->reachable = true;
+                pending.push_back(referent);
+            }
+        });
+    }
+
+    // 3. Break the unreachable objects apart. They are kept alive until all
+    // of them are cleared, so none is destroyed while another still points
+    // at it; dropping the last references then frees them.
+    std::vector<std::shared_ptr<Environment>> environments;
+    std::vector<std::shared_ptr<Function>> functions;
+    std::vector<std::shared_ptr<Hash>> hashes;
+    for (Collectable* c = head; c != nullptr; c = c->next) {
+        if (c->reachable) {
+            continue;
+        }
+        switch (c->kind) {
+            case Kind::ENVIRONMENT: environments.push_back(asEnvironment(c)->shared_from_this()); break;
+            case Kind::FUNCTION: functions.push_back(asFunction(c)->shared_from_this()); break;
+            case Kind::HASH: hashes.push_back(asHash(c)->shared_from_this()); break;
+        }
+    }
+    for (const auto& env : environments) {
+        env->clear();
+    }
+    for (const auto& fn : functions) {
+        fn->env.reset();
+        fn->memo.reset();
+    }
+    for (const auto& hash : hashes) {
+        hash->clear();
+    }
+    size_t freed = environments.size() + functions.size() + hashes.size();
+    environments.clear();
+    functions.clear();
+    hashes.clear();
+
+    totals.collections++;
+    totals.freed += freed;
+    totals.lastSurvivors = tracked;
+    totals.pauseMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    allocated = 0;
+    nextCollection = tracked > threshold ? tracked : threshold;
+    collecting = false;
+    return freed;
+}
+
+void Heap::adopt(Heap& other) {
+    if (&other == this) {
+        return;
+    }
+    Collectable* tail = nullptr;
+    for (Collectable* c = other.head; c != nullptr; c = c->next) {
+        c->owner = this;
+        tail = c;
+    }
+    if (tail != nullptr) {
+        tail->next = head;
+        if (head != nullptr) {
+            head->prev = tail;
+        }
+        head = other.head;
+    }
+    tracked += other.tracked;
+    allocated += other.allocated;
+    totals.collections += other.totals.collections;
+    totals.freed += other.totals.freed;
+    totals.pauseMilliseconds += other.totals.pauseMilliseconds;
+
+    other.head = nullptr;
+    other.tracked = 0;
+    other.allocated = 0;
+    other.totals = Stats();
+}
+
+Stats Heap::stats() const {
+    Stats result = totals;
+    result.tracked = tracked;
+    return result;
+}
+
+void Heap::printStats(std::ostream& out) const {
+    Stats s = stats();
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "gc: %llu collections, %llu objects freed, %zu live, %zu after last collection, %.3f ms paused, threshold %zu\n",
+                  static_cast<unsigned long long>(s.collections), static_cast<unsigned long long>(s.freed), s.tracked,
+                  s.lastSurvivors, s.pauseMilliseconds, threshold);
+    out << line;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+namespace gc {
+
+// === Collectable kinds, used to traverse an object without RTTI ===
+enum class Kind : uint8_t {
+    ENVIRONMENT,
+    FUNCTION,
+    HASH,
+};
+
+class Heap;
+
+// Base of the objects that can form reference cycles: an environment holds
+// functions in its slots and every function holds the environment it was
+// created in. A hash can hold either of them. Instances link themselves
+// into the list of tracked objects of the heap they were created on for
+// their lifetime, so the collector can find them.
+class Collectable {
+public:
+    const Kind kind;
+
+    Collectable(const Collectable&) = delete;
+    Collectable& operator=(const Collectable&) = delete;
+
+protected:
+    explicit Collectable(Kind kind);
+    ~Collectable();
+
+private:
+    friend class Heap;
+
+    Heap* owner;
+    Collectable* prev = nullptr;
+    Collectable* next = nullptr;
+    int64_t gcRefs = 0; // scratch space for a collection
+    bool reachable = false;
+};
+
+struct Stats {
+    uint64_t collections = 0;
+    uint64_t freed = 0;       // objects reclaimed by all collections
+    size_t tracked = 0;       // live collectable objects
+    size_t lastSurvivors = 0; // objects left after the last collection
+    double pauseMilliseconds = 0; // time spent in all collections
+};
+
+// Reclaims garbage cycles among collectable objects. Plain reference
+// counting still frees everything else, and most frames too; a collection
+// only has to find the groups of objects that keep each other alive.
+//
+// An object is a root when something other than a tracked object holds a
+// reference to it: the global environment of the REPL, the runner or an
+// isolate, or a shared_ptr or Value on the evaluator's C++ stack. Whatever
+// the roots do not reach is unreachable and is broken apart so reference
+// counting frees it.
+class Heap {
+public:
+    static constexpr size_t DEFAULT_THRESHOLD = 10000;
+
+    // Collects when enough tracked objects were allocated since the last
+    // collection: the threshold, or the number of survivors if larger, so
+    // the work per allocation stays constant as the heap grows.
+    void maybeCollect() {
+        if (allocated >= nextCollection) {
+            collect();
+        }
+    }
+
+    // Runs a full collection and returns the number of objects freed.
+    size_t collect();
+
+    void setThreshold(size_t objects) { threshold = objects > 0 ? objects : 1; nextCollection = threshold; }
+    size_t getThreshold() const { return threshold; }
+
+    Stats stats() const;
+    void printStats(std::ostream& out) const;
+
+    // Takes over another heap's objects and statistics, leaving it empty.
+    // Neither heap may be in use by another thread meanwhile.
+    void adopt(Heap& other);
+
+private:
+    friend class Collectable;
+
+    void link(Collectable* object) {
+        object->next = head;
+        if (head != nullptr) {
+            head->prev = object;
+        }
+        head = object;
+        tracked++;
+        allocated++;
+    }
+
+    void unlink(Collectable* object) {
+        if (object->prev != nullptr) {
+            object->prev->next = object->next;
+        } else {
+            head = object->next;
+        }
+        if (object->next != nullptr) {
+            object->next->prev = object->prev;
+        }
+        tracked--;
+    }
+
+    Collectable* head = nullptr;
+    size_t tracked = 0;
+    size_t allocated = 0; // since the last collection
+    size_t threshold = DEFAULT_THRESHOLD;
+    size_t nextCollection = DEFAULT_THRESHOLD;
+    bool collecting = false;
+    Stats totals;
+};
+
+// The calling thread's own heap. Threads only ever collect the heap they
+// use, and an object stays on the heap it was created on until that heap
+// is adopted by another (see parallel::forEachChunk).
+extern thread_local Heap heap;
+
+// The heap of the isolate::Isolate running on the calling thread, or
+// nullptr outside of one.
+extern thread_local Heap* active;
+
+// The heap new objects are created on.
+inline Heap& current() {
+    return active != nullptr ? *active : heap;
+}
+
+inline Collectable::Collectable(Kind kind) : kind(kind), owner(&current()) {
+    owner->link(this);
+}
+
+inline Collectable::~Collectable() {
+    owner->unlink(this);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "isolate.h"
+
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../optimizer/optimizer.h"
+#include "../resolver/resolver.h"
+
+namespace isolate {
+
+Isolate::Scope::Scope(Isolate& isolate)
+    : heap(gc::active), strings(object::activeInternTable), counters(stats::active),
+      context(evaluator::setContext(&isolate.context_)) {
+    gc::active = &isolate.heap_;
+    object::activeInternTable = &isolate.strings_;
+    stats::active = &isolate.stats_;
+}
+
+Isolate::Scope::~Scope() {
+    gc::active = heap;
+    object::activeInternTable = strings;
+    stats::active = counters;
+    evaluator::setContext(context);
+}
+
+Isolate::Isolate() {
+    Scope scope(*this);
+    globals = object::newEnvironment();
+}
+
+// Whatever is left once the globals are gone is either garbage or held by
+// values the isolate returned. The heap of the destroying thread takes
+// over the latter, and its counters the isolate's statistics, so freeing
+// those values later balances them; strings_ stops interning them.
+Isolate::~Isolate() {
+    {
+        Scope scope(*this);
+        globals.reset();
+        heap_.collect();
+    }
+    gc::current().adopt(heap_);
+    stats::current().adopt(stats_);
+}
+
+object::Value Isolate::run(std::string_view source, std::vector<std::string>& errors) {
+    auto l = std::make_shared<lexer::Lexer>(source, lexer::SourceMode::BORROW);
+    parser::Parser p(l);
+    auto program = p.parseProgram();
+    if (!p.errors().empty()) {
+        errors = p.errors();
+        return object::Value();
+    }
+    return run(program);
+}
+
+object::Value Isolate::run(const std::shared_ptr<ast::Program>& program) {
+    Scope scope(*this);
+    stats_.programLoaded(optimizer::countNodes(program.get()), program->arena.bytesUsed());
+    resolver::Resolver(globals).resolve(program);
+    return evaluator::eval(program, globals);
+}
+
+}
\ No newline at end of file
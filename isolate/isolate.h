@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../ast/ast.h"
+#include "../environment/environment.h"
+#include "../evaluator/evaluator.h"
+#include "../gc/gc.h"
+#include "../object/object.h"
+#include "../stats/stats.h"
+
+namespace isolate {
+
+// An interpreter instance that shares no mutable state with others. It
+// owns a global environment, a collector heap, a string intern table,
+// allocation statistics and an evaluator::Context (call statistics,
+// settings and builtin objects), so
+// isolates running on different threads never wait for each other or
+// write to the same cache lines. Programs run on the tree-walking
+// evaluator.
+//
+// Only one thread may use an isolate at a time, but it need not always be
+// the same one. Values it returned may outlive it.
+class Isolate {
+public:
+    Isolate();
+    ~Isolate();
+    Isolate(const Isolate&) = delete;
+    Isolate& operator=(const Isolate&) = delete;
+
+    // Parses, resolves and evaluates source in the global environment, so
+    // later runs see its let bindings, like lines typed into the REPL. If
+    // the source does not parse, returns null and fills errors.
+    object::Value run(std::string_view source, std::vector<std::string>& errors);
+
+    // Evaluates a parsed program. Its call site caches become this
+    // isolate's, so no other isolate may run the same program.
+    object::Value run(const std::shared_ptr<ast::Program>& program);
+
+    gc::Heap& heap() { return heap_; }
+    stats::Counters& stats() { return stats_; }
+    evaluator::Context& context() { return context_; }
+
+private:
+    // Installs the isolate's heap, intern table, counters and context on
+    // the calling thread for the lifetime of the scope.
+    class Scope {
+    public:
+        explicit Scope(Isolate& isolate);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        gc::Heap* heap;
+        object::InternTable* strings;
+        stats::Counters* counters;
+        evaluator::Context* context;
+    };
+
+    gc::Heap heap_;
+    object::InternTable strings_;
+    stats::Counters stats_;
+    evaluator::Context context_;
+    std::shared_ptr<object::Environment> globals;
+};
+
+}
\ No newline at end of file
@@ -1,10 +1,17 @@
 #include "lexer.h"
+#include <algorithm>
 #include <cctype>
 #include <string>
 
 namespace lexer {
 
-Lexer::Lexer(const std::string& input): input(input) {
+Lexer::Lexer(std::string_view source, SourceMode mode) {
+    if (mode == SourceMode::COPY) {
+        owned.assign(source.data(), source.size());
+        input = owned;
+    } else {
+        input = source;
+    }
     readChar();
 }
 
@@ -26,27 +33,37 @@ char Lexer::peekChar() const {
 }
 
 void Lexer::skipWhitespace() {
-    while(std::isspace(ch)) {
+    while(std::isspace(static_cast<unsigned char>(ch))) {
         readChar();
     }
 }
 
-std::string Lexer::readIdentifier() {
-    int start = position;
+std::string_view Lexer::readIdentifier() {
+    size_t start = position;
     while(isLetter(ch)) {
         readChar();
     }
     return input.substr(start, position - start);
 }
 
-std::string Lexer::readNumber() {
-    int start = position;
+std::string_view Lexer::readNumber() {
+    size_t start = position;
     while(isDigit(ch)) {
         readChar();
     }
     return input.substr(start, position - start);
 }
 
+// Reads up to the closing quote, or to the end of the input if there is
+// none, and leaves the lexer on it. There are no escape sequences.
+std::string_view Lexer::readString() {
+    size_t start = position + 1;
+    do {
+        readChar();
+    } while(ch != '"' && ch != 0);
+    return input.substr(start, position - start);
+}
+
 token::Token Lexer::nextToken() {
     token::Token tok;
     skipWhitespace();
@@ -54,71 +71,85 @@ token::Token Lexer::nextToken() {
     switch(ch) {
         case '=':
             if(peekChar() == '=') {
-                char c = ch;
                 readChar();
-                tok = token::Token{token::TokenType::EQ, std::string(1, c) + ch};
+                tok = newToken(token::TokenType::EQ, position - 1, 2);
             } else {
-                tok = newToken(token::TokenType::ASSIGN, ch);
+                tok = newToken(token::TokenType::ASSIGN, position, 1);
             }
             break;
         case '+':
-            tok = newToken(token::TokenType::PLUS, ch);
+            tok = newToken(token::TokenType::PLUS, position, 1);
             break;
         case '-':
-            tok = newToken(token::TokenType::MINUS, ch);
+            tok = newToken(token::TokenType::MINUS, position, 1);
             break;
         case '!':
             if(peekChar() == '=') {
-                char c = ch;
                 readChar();
-                tok = token::Token{token::TokenType::NOT_EQ, std::string(1, c) + ch};
+                tok = newToken(token::TokenType::NOT_EQ, position - 1, 2);
             } else {
-                tok = newToken(token::TokenType::BANG, ch);
+                tok = newToken(token::TokenType::BANG, position, 1);
             }
             break;
         case '/':
-            tok = newToken(token::TokenType::SLASH, ch);
+            tok = newToken(token::TokenType::SLASH, position, 1);
             break;
         case '*':
-            tok = newToken(token::TokenType::ASTERISK, ch);
+            tok = newToken(token::TokenType::ASTERISK, position, 1);
             break;
         case '<':
-            tok = newToken(token::TokenType::LT, ch);
+            tok = newToken(token::TokenType::LT, position, 1);
             break;
         case '>':
-            tok = newToken(token::TokenType::GT, ch);
+            tok = newToken(token::TokenType::GT, position, 1);
             break;
         case ';':
-            tok = newToken(token::TokenType::SEMICOLON, ch);
+            tok = newToken(token::TokenType::SEMICOLON, position, 1);
+            break;
+        case '"': {
+            size_t start = position + 1;
+            std::string_view literal = readString();
+            tok = newToken(token::TokenType::STRING, start, literal.size());
+            break;
+        }
+        case ':':
+            tok = newToken(token::TokenType::COLON, position, 1);
             break;
         case '(':
-            tok = newToken(token::TokenType::LPAREN, ch);
+            tok = newToken(token::TokenType::LPAREN, position, 1);
             break;
         case ')':
-            tok = newToken(token::TokenType::RPAREN, ch);
+            tok = newToken(token::TokenType::RPAREN, position, 1);
             break;
         case ',':
-            tok = newToken(token::TokenType::COMMA, ch);
+            tok = newToken(token::TokenType::COMMA, position, 1);
             break;
         case '{':
-            tok = newToken(token::TokenType::LBRACE, ch);
+            tok = newToken(token::TokenType::LBRACE, position, 1);
             break;
         case '}':
-            tok = newToken(token::TokenType::RBRACE, ch);
+            tok = newToken(token::TokenType::RBRACE, position, 1);
+            break;
+        case '[':
+            tok = newToken(token::TokenType::LBRACKET, position, 1);
+            break;
+        case ']':
+            tok = newToken(token::TokenType::RBRACKET, position, 1);
             break;
         case 0:
-            tok = {token::TokenType::EOF_TOKEN, ""};
+            tok = newToken(token::TokenType::EOF_TOKEN, position, 0);
             break;
         default:
             if(isLetter(ch)) {
-                std::string literal = readIdentifier();
-                token::TokenType type = token::lookupIdent(literal);
-                return token::Token(type, literal);
+                size_t start = position;
+                std::string_view literal = readIdentifier();
+                return newToken(token::lookupIdent(literal), start, literal.size());
             } else if(isDigit(ch)) {
-                std::string literal = readNumber();
-                return token::Token(token::TokenType::INT, literal);
+                size_t start = position;
+                std::string_view literal = readNumber();
+                return newToken(token::TokenType::INT, start, literal.size());
             } else {
-                tok = newToken(token::TokenType::ILLEGAL, ch);
+                tok = newToken(token::TokenType::ILLEGAL, position, 1);
             }
             break;
     }
@@ -127,16 +158,17 @@ token::Token Lexer::nextToken() {
     return tok;
 }
 
-token::Token newToken(token::TokenType type, char ch) {
-    return token::Token{type, std::string(1, ch)};
+token::Token Lexer::newToken(token::TokenType type, size_t start, size_t length) const {
+    start = std::min(start, input.size()); // EOF is reported past the end
+    return token::Token{type, input.substr(start, length), static_cast<uint32_t>(start)};
 }
 
 bool isLetter(char ch) {
-    return std::isalpha(ch) || ch == '_';
+    return std::isalpha(static_cast<unsigned char>(ch)) || ch == '_';
 }
 
 bool isDigit(char ch) {
-    return std::isdigit(ch);
+    return std::isdigit(static_cast<unsigned char>(ch));
 }
 
 }
\ No newline at end of file
@@ -1,29 +1,42 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include "../token/token.h"
 
 namespace lexer {
 
-token::Token newToken(token::TokenType token, char ch);
 bool isLetter(char ch);
 bool isDigit(char ch);
 
+// How a Lexer holds its input. COPY keeps a private copy; BORROW lexes the
+// caller's buffer in place, which must then outlive the lexer and every
+// token it returns.
+enum class SourceMode {
+    COPY,
+    BORROW,
+};
+
 class Lexer {
 private:
-    std::string input;
-    int position = 0;
-    int readPosition = 0;
+    std::string owned; // the input in COPY mode
+    std::string_view input;
+    size_t position = 0;
+    size_t readPosition = 0;
     char ch = 0;
 
     void readChar();
-    std::string readIdentifier();
+    std::string_view readIdentifier();
     void skipWhitespace();
-    std::string readNumber();
+    std::string_view readNumber();
+    std::string_view readString();
     char peekChar() const;
+    token::Token newToken(token::TokenType type, size_t start, size_t length) const;
 
 public:
-    explicit Lexer(const std::string& input);
+    explicit Lexer(std::string_view input, SourceMode mode = SourceMode::COPY);
+    Lexer(const Lexer&) = delete;
+    Lexer& operator=(const Lexer&) = delete;
 
     token::Token nextToken();
 };
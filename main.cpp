@@ -1,9 +1,107 @@
 #include "repl/repl.h"
+#include "runner/runner.h"
+#include "gc/gc.h"
+#include "stats/stats.h"
+#include "evaluator/evaluator.h"
+#include "parallel/parallel.h"
+#include <cstdlib>
 #include <iostream>
+#include <string>
+
+namespace {
+int usage(const char* program) {
+    std::cerr << "usage: " << program << " [--engine=eval|vm] [--optimize] [--profile] [--gc-stats] [--stats] [--gc-threshold=N] [--memo-capacity=N] [--threads=N]\n";
+    std::cerr << "       " << program << " run [--engine=eval|vm] [--optimize] [--profile] [--gc-stats] [--stats] [--gc-threshold=N] [--memo-capacity=N] [--threads=N] [--cache-dir=DIR] file.mk\n";
+    std::cerr << "       " << program << " batch [--optimize] [--profile] [--gc-stats] [--stats] [--gc-threshold=N] [--memo-capacity=N] [--threads=N] [--cache-dir=DIR] script.mk < records.jsonl\n";
+    return 1;
+}
+}
+
+int main(int argc, char* argv[]) {
+    repl::Options options;
+    bool run = argc > 1 && std::string(argv[1]) == "run";
+    bool batch = argc > 1 && std::string(argv[1]) == "batch";
+    bool gcStats = false;
+    std::string path;
+    for (int i = run || batch ? 2 : 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--engine=vm") {
+            options.engine = repl::Engine::VM;
+        } else if (arg == "--engine=eval") {
+            options.engine = repl::Engine::EVALUATOR;
+        } else if (arg == "--optimize") {
+            options.optimize = true;
+        } else if (arg == "--profile") {
+            options.profile = true;
+        } else if (arg == "--gc-stats") {
+            gcStats = true;
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg.rfind("--gc-threshold=", 0) == 0) {
+            long objects = std::atol(arg.c_str() + 15);
+            if (objects <= 0) {
+                return usage(argv[0]);
+            }
+            gc::heap.setThreshold(static_cast<size_t>(objects));
+        } else if (arg.rfind("--memo-capacity=", 0) == 0) {
+            long results = std::atol(arg.c_str() + 16);
+            if (results <= 0) {
+                return usage(argv[0]);
+            }
+            evaluator::setMemoCapacity(static_cast<size_t>(results));
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            long threads = std::atol(arg.c_str() + 10);
+            if (threads <= 0) {
+                return usage(argv[0]);
+            }
+            parallel::setThreadCount(static_cast<size_t>(threads));
+        } else if ((run || batch) && arg.rfind("--cache-dir=", 0) == 0 && arg.size() > 12) {
+            options.cacheDirectory = arg.substr(12);
+        } else if ((run || batch) && path.empty() && arg.rfind("--", 0) != 0) {
+            path = arg;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    if (options.profile && options.engine == repl::Engine::VM) {
+        std::cerr << "--profile is only supported by the evaluator\n";
+        return 1;
+    }
+
+    if (batch && options.engine == repl::Engine::VM) {
+        std::cerr << "batch is only supported by the evaluator\n";
+        return 1;
+    }
+
+    if (run || batch) {
+        if (path.empty()) {
+            return usage(argv[0]);
+        }
+        int status;
+        if (batch) {
+            std::ios::sync_with_stdio(false);
+            status = runner::runBatch(path, options, std::cin, std::cout, std::cerr);
+        } else {
+            status = runner::runFile(path, options, std::cout, std::cerr);
+        }
+        if (gcStats) {
+            gc::heap.printStats(std::cerr);
+        }
+        if (options.stats) {
+            stats::counters.print(std::cerr);
+        }
+        return status;
+    }
 
-int main() {
     std::cout << "Hello! This is the Monkey Programming Language (C++ version)\n";
     std::cout << "Feel free to type in commands.\n";
-    repl::start(std::cin, std::cout);
+    repl::start(std::cin, std::cout, options);
+    if (gcStats) {
+        gc::heap.printStats(std::cerr);
+    }
+    if (options.stats) {
+        stats::counters.print(std::cerr);
+    }
     return 0;
 }
\ No newline at end of file
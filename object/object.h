@@ -1,8 +1,18 @@
 #pragma once
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <list>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <utility>
 #include "../ast/ast.h"
+#include "../code/code.h"
+#include "../gc/gc.h"
 
 namespace object {
 
@@ -12,9 +22,14 @@ enum class ObjectType{
     INTEGER_OBJ,
     BOOLEAN_OBJ,
     NULL_OBJ,
-    RETURN_VALUE_OBJ,
     ERROR_OBJ,
-    FUNCTION_OBJ
+    FUNCTION_OBJ,
+    INT_ARRAY_OBJ,
+    BUILTIN_OBJ,
+    HASH_OBJ,
+    STRING_OBJ,
+    COMPILED_FUNCTION_OBJ,
+    CLOSURE_OBJ
 };
 
 inline std::string objectTypeToString(ObjectType type) {
@@ -22,12 +37,45 @@ inline std::string objectTypeToString(ObjectType type) {
         case ObjectType::INTEGER_OBJ: return "INTEGER";
         case ObjectType::BOOLEAN_OBJ: return "BOOLEAN";
         case ObjectType::NULL_OBJ: return "NULL";
-        case ObjectType::RETURN_VALUE_OBJ: return "RETURN_VALUE";
         case ObjectType::ERROR_OBJ: return "ERROR";
         case ObjectType::FUNCTION_OBJ: return "FUNCTION";
+        case ObjectType::INT_ARRAY_OBJ: return "INT_ARRAY";
+        case ObjectType::BUILTIN_OBJ: return "BUILTIN";
+        case ObjectType::HASH_OBJ: return "HASH";
+        case ObjectType::STRING_OBJ: return "STRING";
+        case ObjectType::COMPILED_FUNCTION_OBJ: return "COMPILED_FUNCTION";
+        case ObjectType::CLOSURE_OBJ: return "CLOSURE";
     }
 }
 
+// The name of a type in error messages. The vm's closures are functions
+// to the user, as in the evaluator.
+inline std::string typeName(ObjectType type) {
+    if (type == ObjectType::CLOSURE_OBJ || type == ObjectType::COMPILED_FUNCTION_OBJ) {
+        return "FUNCTION";
+    }
+    return objectTypeToString(type);
+}
+
+// === Integer arithmetic ===
+// Integers wrap around on overflow, in the evaluator and the vm as in the
+// array kernels (see simd.h), so INT64_MIN / -1 is INT64_MIN too.
+inline int64_t wrappingAdd(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+inline int64_t wrappingSubtract(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+}
+inline int64_t wrappingMultiply(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+}
+inline int64_t wrappingNegate(int64_t a) {
+    return static_cast<int64_t>(0 - static_cast<uint64_t>(a));
+}
+inline int64_t wrappingDivide(int64_t a, int64_t b) { // b != 0: callers report division by zero
+    return b == -1 ? wrappingNegate(a) : a / b;
+}
+
 class Object {
 public:
     virtual ObjectType type() const = 0;
@@ -35,37 +83,91 @@ public:
     virtual ~Object() {}
 };
 
-class Integer : public Object {
+// === Value ===
+// A tagged value. Integers, booleans and null are stored inline; only heap
+// objects such as functions and errors are boxed behind a shared_ptr.
+class Value {
 public:
-    int64_t value;
-    Integer(int64_t value) : value(value) {}
+    enum class Tag : uint8_t {
+        NULL_VALUE,
+        INTEGER,
+        BOOLEAN,
+        OBJECT,
+        UNDEFINED, // an environment slot that has not been bound yet
+    };
 
-    ObjectType type() const override { return ObjectType::INTEGER_OBJ; }
-    std::string inspect() const override { return std::to_string(value); }
-};
+    Value() : tag_(Tag::NULL_VALUE), integer_(0) {}
 
-class Boolean : public Object {
-public:
-    bool value;
-    Boolean(bool value) : value(value) {}
+    template <typename T>
+    Value(std::shared_ptr<T> obj)
+        : tag_(obj != nullptr ? Tag::OBJECT : Tag::NULL_VALUE), integer_(0), object_(std::move(obj)) {}
 
-    ObjectType type() const override { return ObjectType::BOOLEAN_OBJ; }
-    std::string inspect() const override { return value ? "true" : "false"; }
-};
+    static Value null() { return Value(); }
 
-class Null : public Object {
-public:
-    ObjectType type() const override { return ObjectType::NULL_OBJ; }
-    std::string inspect() const override { return "null"; }
-};
+    static Value undefined() {
+        Value v;
+        v.tag_ = Tag::UNDEFINED;
+        return v;
+    }
 
-class ReturnValue : public Object {
-public:
-    std::shared_ptr<Object> value;
-    ReturnValue(std::shared_ptr<Object> value) : value(value) {}
+    static Value integer(int64_t value) {
+        Value v;
+        v.tag_ = Tag::INTEGER;
+        v.integer_ = value;
+        return v;
+    }
+
+    static Value boolean(bool value) {
+        Value v;
+        v.tag_ = Tag::BOOLEAN;
+        v.boolean_ = value;
+        return v;
+    }
+
+    Tag tag() const { return tag_; }
+    bool isNull() const { return tag_ == Tag::NULL_VALUE; }
+    bool isInteger() const { return tag_ == Tag::INTEGER; }
+    bool isBoolean() const { return tag_ == Tag::BOOLEAN; }
+    bool isObject() const { return tag_ == Tag::OBJECT; }
+    bool isUndefined() const { return tag_ == Tag::UNDEFINED; }
+
+    int64_t integerValue() const { return integer_; }
+    bool booleanValue() const { return boolean_; }
+    const std::shared_ptr<Object>& object() const { return object_; }
+
+    // True if the value is a heap object of the given type.
+    bool is(ObjectType type) const { return tag_ == Tag::OBJECT && object_->type() == type; }
+
+    ObjectType type() const {
+        switch (tag_) {
+            case Tag::INTEGER: return ObjectType::INTEGER_OBJ;
+            case Tag::BOOLEAN: return ObjectType::BOOLEAN_OBJ;
+            case Tag::OBJECT: return object_->type();
+            default: return ObjectType::NULL_OBJ;
+        }
+    }
+
+    std::string inspect() const {
+        switch (tag_) {
+            case Tag::INTEGER: return std::to_string(integer_);
+            case Tag::BOOLEAN: return boolean_ ? "true" : "false";
+            case Tag::OBJECT: return object_->inspect();
+            default: return "null";
+        }
+    }
+
+    // Integers, booleans and null compare by value, strings by their text
+    // and other heap objects by identity.
+    bool operator==(const Value& other) const;
+    bool operator!=(const Value& other) const { return !(*this == other); }
 
-    ObjectType type() const override { return ObjectType::RETURN_VALUE_OBJ; }
-    std::string inspect() const override { return value->inspect(); }
+private:
+    Tag tag_;
+    union {
+        int64_t integer_;
+        bool boolean_;
+    };
+    std::shared_ptr<Object> object_;
 };
 
 class Error : public Object {
@@ -79,30 +181,584 @@ public:
 
 class Environment;
 
-class Function : public Object {
+inline std::string inspectFunction(const ast::FunctionLiteral* literal) {
+    const auto& parameters = literal->parameters;
+    std::string result = literal->memoized ? "memo fn(" : "fn(";
+
+    for (size_t i=0; i<parameters.size(); i++) {
+        result += parameters[i]->toString();
+        if (i != parameters.size() - 1) {
+            result += ", ";
+        }
+    }
+    result += ") {\n";
+    result += literal->body->toString();
+    result += "\n}";
+
+    return result;
+}
+
+// === Memo table ===
+// The results of a `memo fn`, keyed by its argument values. Only integers
+// and booleans can be part of a key; calls with other arguments are not
+// cached. At most `capacity` results are kept, evicting the least recently
+// used one.
+class MemoTable {
+public:
+    using Key = std::vector<int64_t>;
+
+    explicit MemoTable(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+    // Fills key from the arguments, or returns false if one of them cannot
+    // be part of a key.
+    static bool makeKey(const Value* args, size_t count, Key& key) {
+        key.clear();
+        for (size_t i = 0; i < count; i++) {
+            if (args[i].isInteger()) {
+                key.push_back(0);
+                key.push_back(args[i].integerValue());
+            } else if (args[i].isBoolean()) {
+                key.push_back(1);
+                key.push_back(args[i].booleanValue());
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Returns the cached result, or nullptr, and marks it most recently used.
+    const Value* find(const Key& key) {
+        auto it = index.find(&key);
+        if (it == index.end()) {
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->value;
+    }
+
+    // Adds a result and returns true if another one had to be evicted.
+    bool insert(Key key, Value value) {
+        if (index.find(&key) != index.end()) {
+            return false; // stored by a recursive call in the meantime
+        }
+        bool evicted = false;
+        if (entries.size() >= capacity) {
+            index.erase(&entries.back().key);
+            entries.pop_back();
+            evicted = true;
+        }
+        entries.push_front(Entry{std::move(key), std::move(value)});
+        index.emplace(&entries.front().key, entries.begin());
+        return evicted;
+    }
+
+    size_t size() const { return entries.size(); }
+
+    template <typename Visit>
+    void forEachValue(Visit visit) const {
+        for (const auto& entry : entries) {
+            visit(entry.value);
+        }
+    }
+
+private:
+    struct Entry {
+        Key key;
+        Value value;
+    };
+    struct KeyHash {
+        size_t operator()(const Key* key) const {
+            size_t h = key->size();
+            for (int64_t k : *key) {
+                h ^= std::hash<int64_t>()(k) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            }
+            return h;
+        }
+    };
+    struct KeyEqual {
+        bool operator()(const Key* a, const Key* b) const { return *a == *b; }
+    };
+
+    size_t capacity;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<const Key*, std::list<Entry>::iterator, KeyHash, KeyEqual> index; // keys point into entries
+};
+
+// Tracked by the collector: a function and the environment it closes over
+// often refer to each other, e.g. through the function's own let binding.
+class Function : public Object, public gc::Collectable, public std::enable_shared_from_this<Function> {
 public:
-    std::vector<std::shared_ptr<ast::Identifier>> parameters;
-    std::shared_ptr<ast::BlockStatement> body;
+    const ast::FunctionLiteral* literal; // parameters, body and frame size
+    std::shared_ptr<const ast::Program> program; // keeps the literal's arena alive
     std::shared_ptr<Environment> env;
-    Function(std::vector<std::shared_ptr<ast::Identifier>> parameters, std::shared_ptr<ast::BlockStatement> body, std::shared_ptr<Environment> env)
-        : parameters(parameters), body(body), env(env) {}
-    
+    std::unique_ptr<MemoTable> memo; // set for `memo fn` literals
+    Function(const ast::FunctionLiteral* literal, std::shared_ptr<const ast::Program> program, std::shared_ptr<Environment> env)
+        : gc::Collectable(gc::Kind::FUNCTION), literal(literal), program(program), env(env) {}
+
     ObjectType type() const override { return ObjectType::FUNCTION_OBJ; }
-    std::string inspect() const override {
-        std::string result = "fn(";
+    std::string inspect() const override { return inspectFunction(literal); }
+};
+
+// An array of integers in one contiguous buffer, so the builtins can run
+// over it with vector instructions.
+class IntArray : public Object {
+public:
+    std::vector<int64_t> elements;
+    IntArray() {}
+    explicit IntArray(std::vector<int64_t> elements) : elements(std::move(elements)) {}
 
-        for (size_t i=0; i<parameters.size(); i++) {
-            result += parameters[i]->toString();
-            if (i != parameters.size() - 1) {
+    ObjectType type() const override { return ObjectType::INT_ARRAY_OBJ; }
+    std::string inspect() const override {
+        std::string result = "[";
+        for (size_t i = 0; i < elements.size(); i++) {
+            if (i > 0) {
                 result += ", ";
             }
+            result += std::to_string(elements[i]);
+        }
+        return result + "]";
+    }
+};
+
+// A function implemented in C++ (see builtins::lookup). Shared by both
+// engines.
+using BuiltinFunction = Value (*)(const Value* args, size_t count);
+
+class Builtin : public Object {
+public:
+    const char* name;
+    BuiltinFunction fn;
+    Builtin(const char* name, BuiltinFunction fn) : name(name), fn(fn) {}
+
+    ObjectType type() const override { return ObjectType::BUILTIN_OBJ; }
+    std::string inspect() const override { return std::string("builtin function ") + name; }
+};
+
+// === String ===
+// Immutable text. Concatenating long strings makes a rope node that keeps
+// both halves and is flattened into one buffer only when the text itself
+// is needed (inspect, indexing, comparing or hashing), so building a
+// string piece by piece costs linear rather than quadratic time.
+//
+// String literals and short identifier-like strings are interned (see
+// intern): there is one String per such text, so two interned strings are
+// equal exactly when they are the same object, provided they come from
+// the same InternTable.
+//
+// Strings are shared between the threads of parallel builtins, so the lazy
+// state (the flattened text and the hash) is published atomically.
+class InternTable;
+
+class String : public Object, public std::enable_shared_from_this<String> {
+public:
+    // Concatenations shorter than this are copied into a flat string.
+    static constexpr size_t ROPE_THRESHOLD = 64;
+
+    explicit String(std::string text) : length(text.size()), text(std::move(text)), isFlat(true) {}
+    String(std::shared_ptr<String> left, std::shared_ptr<String> right)
+        : length(left->size() + right->size()), left(std::move(left)), right(std::move(right)), isFlat(false) {}
+    ~String() override;
+
+    static std::shared_ptr<String> concat(const std::shared_ptr<String>& left, const std::shared_ptr<String>& right);
+    // The same, creating new strings with make(left, right) for a rope and
+    // make(text) for flat text, e.g. to account for them.
+    template <typename Make>
+    static std::shared_ptr<String> concat(const std::shared_ptr<String>& left, const std::shared_ptr<String>& right, Make make);
+
+    // Short strings that look like identifiers, e.g. hash keys.
+    static bool identifierLike(std::string_view text) {
+        if (text.empty() || text.size() >= ROPE_THRESHOLD || std::isdigit(static_cast<unsigned char>(text[0]))) {
+            return false;
+        }
+        for (char c : text) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t size() const { return length; }
+    bool isInterned() const { return internedIn != nullptr; }
+
+    // The text in one buffer; flattens a rope the first time.
+    const std::string& flat() const {
+        if (!isFlat.load(std::memory_order_acquire)) {
+            flatten();
+        }
+        return text;
+    }
+
+    uint64_t hash() const {
+        uint64_t h = hashCode.load(std::memory_order_relaxed);
+        if (h == 0) {
+            h = 0xcbf29ce484222325ULL; // FNV-1a
+            for (unsigned char c : flat()) {
+                h = (h ^ c) * 0x100000001b3ULL;
+            }
+            h = h != 0 ? h : 1; // 0 means not computed yet
+            hashCode.store(h, std::memory_order_relaxed);
+        }
+        return h;
+    }
+
+    bool equals(const String& other) const {
+        if (this == &other) {
+            return true;
+        }
+        if (length != other.length || (internedIn != nullptr && internedIn == other.internedIn)) {
+            return false;
+        }
+        uint64_t h = hashCode.load(std::memory_order_relaxed);
+        uint64_t otherHash = other.hashCode.load(std::memory_order_relaxed);
+        if (h != 0 && otherHash != 0 && h != otherHash) {
+            return false;
+        }
+        return flat() == other.flat();
+    }
+
+    ObjectType type() const override { return ObjectType::STRING_OBJ; }
+    std::string inspect() const override { return flat(); }
+
+private:
+    friend class InternTable;
+
+    // Walks the rope with an explicit stack: ropes built in a loop are
+    // as deep as the number of pieces. One lock serializes all flattening,
+    // which is rare next to reading flat text.
+    void flatten() const {
+        static std::mutex flattening;
+        std::lock_guard<std::mutex> lock(flattening);
+        if (isFlat.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::string result;
+        result.reserve(length);
+        std::vector<const String*> pending{right.get(), left.get()};
+        while (!pending.empty()) {
+            const String* node = pending.back();
+            pending.pop_back();
+            if (node->isFlat.load(std::memory_order_relaxed)) {
+                result += node->text;
+            } else {
+                pending.push_back(node->right.get());
+                pending.push_back(node->left.get());
+            }
+        }
+        text = std::move(result);
+        isFlat.store(true, std::memory_order_release);
+        left.reset();
+        right.reset();
+    }
+
+    size_t length;
+    mutable std::string text; // empty until a rope is flattened
+    mutable std::shared_ptr<String> left;
+    mutable std::shared_ptr<String> right;
+    mutable std::atomic<bool> isFlat;
+    mutable std::atomic<uint64_t> hashCode{0};
+    InternTable* internedIn = nullptr;
+};
+
+// Interned strings by text. Entries point at Strings and are removed by
+// ~String; the table does not keep strings alive. Each isolate::Isolate
+// has a table of its own, everything else shares one.
+class InternTable {
+public:
+    InternTable() = default;
+    InternTable(const InternTable&) = delete;
+    InternTable& operator=(const InternTable&) = delete;
+
+    // Strings that outlive the table are no longer interned.
+    ~InternTable() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& entry : entries) {
+            entry.second->internedIn = nullptr;
         }
-        result += ") {\n";
-        result += body->toString();
-        result += "\n}";
+    }
 
+    // Returns the interned String for a text, creating it if needed.
+    std::shared_ptr<String> intern(std::string_view text) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(text);
+        if (it != entries.end()) {
+            if (auto existing = it->second->weak_from_this().lock()) {
+                return existing;
+            }
+            entries.erase(it); // being destroyed on another thread
+        }
+        auto result = std::make_shared<String>(std::string(text));
+        result->internedIn = this;
+        entries.emplace(result->text, result.get());
         return result;
     }
+
+private:
+    friend class String;
+
+    void remove(const String* string) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(string->text);
+        if (it != entries.end() && it->second == string) {
+            entries.erase(it);
+        }
+    }
+
+    std::mutex mutex;
+    std::unordered_map<std::string_view, String*> entries;
+};
+
+// The table of the isolate::Isolate running on the calling thread, or
+// nullptr outside of one.
+inline thread_local InternTable* activeInternTable = nullptr;
+
+// The table strings are interned in on the calling thread.
+inline InternTable& internTable() {
+    static InternTable shared;
+    return activeInternTable != nullptr ? *activeInternTable : shared;
+}
+
+inline std::shared_ptr<String> intern(std::string_view text) {
+    return internTable().intern(text);
+}
+
+inline String::~String() {
+    if (internedIn != nullptr) {
+        internedIn->remove(this);
+    }
+    // Release a rope iteratively, for the same reason flatten() does not
+    // recurse: nodes this string owns alone are taken apart here.
+    std::vector<std::shared_ptr<String>> pending;
+    if (left != nullptr) pending.push_back(std::move(left));
+    if (right != nullptr) pending.push_back(std::move(right));
+    while (!pending.empty()) {
+        auto node = std::move(pending.back());
+        pending.pop_back();
+        if (node.use_count() == 1) {
+            if (node->left != nullptr) pending.push_back(std::move(node->left));
+            if (node->right != nullptr) pending.push_back(std::move(node->right));
+        }
+    }
+}
+
+template <typename Make>
+std::shared_ptr<String> String::concat(const std::shared_ptr<String>& left, const std::shared_ptr<String>& right, Make make) {
+    if (left->size() == 0) {
+        return right;
+    }
+    if (right->size() == 0) {
+        return left;
+    }
+    if (left->size() + right->size() >= ROPE_THRESHOLD) {
+        return make(left, right);
+    }
+    std::string text;
+    text.reserve(left->size() + right->size());
+    text += left->flat();
+    text += right->flat();
+    if (identifierLike(text)) {
+        return intern(text);
+    }
+    return make(std::move(text));
+}
+
+inline std::shared_ptr<String> String::concat(const std::shared_ptr<String>& left, const std::shared_ptr<String>& right) {
+    return concat(left, right, [](auto&&... args) { return std::make_shared<String>(std::forward<decltype(args)>(args)...); });
+}
+
+inline bool Value::operator==(const Value& other) const {
+    if (tag_ != other.tag_) {
+        return false;
+    }
+    switch (tag_) {
+        case Tag::INTEGER: return integer_ == other.integer_;
+        case Tag::BOOLEAN: return boolean_ == other.boolean_;
+        case Tag::OBJECT:
+            if (object_ == other.object_) {
+                return true;
+            }
+            return object_->type() == ObjectType::STRING_OBJ && other.object_->type() == ObjectType::STRING_OBJ
+                && static_cast<const String&>(*object_).equals(static_cast<const String&>(*other.object_));
+        default: return true;
+    }
+}
+
+// === Hash ===
+// A map from integer, boolean and string keys to values. The entries are kept in
+// insertion order in one vector and indexed by an open-addressing table of
+// 8-byte slots. Each slot caches 32 bits of its key's hash, so a probe only
+// touches an entry when the hashes match. Collisions are resolved Robin
+// Hood style, which keeps probe sequences short at a high load factor.
+// Tracked by the collector: a hash can hold functions whose environment
+// holds the hash.
+class Hash : public Object, public gc::Collectable, public std::enable_shared_from_this<Hash> {
+public:
+    struct Entry {
+        Value key;
+        Value value;
+        uint64_t hash;
+    };
+
+    Hash() : gc::Collectable(gc::Kind::HASH) {}
+
+    static bool hashable(const Value& key) {
+        return key.isInteger() || key.isBoolean() || key.is(ObjectType::STRING_OBJ);
+    }
+
+    // Only valid for hashable keys. Integers and booleans hash apart, so 1
+    // and true are different keys; strings cache their own hash.
+    static uint64_t hashOf(const Value& key) {
+        if (key.isObject()) {
+            return static_cast<const String*>(key.object().get())->hash();
+        }
+        uint64_t x = key.isInteger() ? static_cast<uint64_t>(key.integerValue())
+                                     : (key.booleanValue() ? 1 : 0) ^ 0x9e3779b97f4a7c15ULL;
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // Makes room for `count` entries without growing the table.
+    void reserve(size_t count) {
+        entries.reserve(count);
+        size_t capacity = MIN_SLOTS;
+        while (count * 8 > capacity * 7) {
+            capacity *= 2;
+        }
+        if (capacity > slots.size()) {
+            rehash(capacity);
+        }
+    }
+
+    // Returns nullptr if the key is not in the hash.
+    const Value* get(const Value& key) const {
+        uint64_t hash = hashOf(key);
+        int64_t index = find(key, hash);
+        return index >= 0 ? &entries[index].value : nullptr;
+    }
+
+    // Adds an entry, or replaces the value of an existing key.
+    void set(const Value& key, Value value) {
+        uint64_t hash = hashOf(key);
+        int64_t index = find(key, hash);
+        if (index >= 0) {
+            entries[index].value = std::move(value);
+            return;
+        }
+        if ((entries.size() + 1) * 8 > slots.size() * 7) {
+            rehash(slots.empty() ? MIN_SLOTS : slots.size() * 2);
+        }
+        entries.push_back(Entry{key, std::move(value), hash});
+        place(Slot{static_cast<uint32_t>(hash), static_cast<uint32_t>(entries.size() - 1)});
+    }
+
+    size_t size() const { return entries.size(); }
+    const std::vector<Entry>& items() const { return entries; }
+
+    // Drops every entry; used by the collector to break cycles.
+    void clear() {
+        entries.clear();
+        slots.clear();
+    }
+
+    ObjectType type() const override { return ObjectType::HASH_OBJ; }
+    std::string inspect() const override {
+        std::string result = "{";
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (i > 0) {
+                result += ", ";
+            }
+            result += entries[i].key.inspect() + ": " + entries[i].value.inspect();
+        }
+        return result + "}";
+    }
+
+private:
+    struct Slot {
+        uint32_t hash;  // low bits of the key's hash; they also pick the home slot
+        uint32_t entry; // index into entries, or EMPTY
+    };
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+    static constexpr size_t MIN_SLOTS = 8;
+
+    // How far a slot is from the one its hash prefers.
+    size_t distance(const Slot& slot, size_t position) const {
+        return (position - (slot.hash & (slots.size() - 1))) & (slots.size() - 1);
+    }
+
+    int64_t find(const Value& key, uint64_t hash) const {
+        if (slots.empty()) {
+            return -1;
+        }
+        size_t mask = slots.size() - 1;
+        uint32_t tag = static_cast<uint32_t>(hash);
+        for (size_t position = tag & mask, probed = 0;; position = (position + 1) & mask, probed++) {
+            const Slot& slot = slots[position];
+            // Robin Hood order: once the slots are closer to home than the
+            // key would be, the key is not in the table.
+            if (slot.entry == EMPTY || distance(slot, position) < probed) {
+                return -1;
+            }
+            if (slot.hash == tag && entries[slot.entry].key == key) {
+                return slot.entry;
+            }
+        }
+    }
+
+    void place(Slot slot) {
+        size_t mask = slots.size() - 1;
+        for (size_t position = slot.hash & mask, probed = 0;; position = (position + 1) & mask, probed++) {
+            Slot& resident = slots[position];
+            if (resident.entry == EMPTY) {
+                resident = slot;
+                return;
+            }
+            size_t residentDistance = distance(resident, position);
+            if (residentDistance < probed) {
+                std::swap(resident, slot);
+                probed = residentDistance;
+            }
+        }
+    }
+
+    void rehash(size_t capacity) {
+        slots.assign(capacity, Slot{0, EMPTY});
+        for (size_t i = 0; i < entries.size(); i++) {
+            place(Slot{static_cast<uint32_t>(entries[i].hash), static_cast<uint32_t>(i)});
+        }
+    }
+
+    std::vector<Entry> entries; // in insertion order
+    std::vector<Slot> slots;    // a power of two in size, at most 7/8 full
+};
+
+// === Bytecode objects (used by the vm) ===
+class CompiledFunction : public Object {
+public:
+    code::Instructions instructions;
+    int numLocals;
+    int numParameters;
+    std::string source; // printed by inspect(), so closures look like evaluator functions
+    CompiledFunction(code::Instructions instructions, int numLocals, int numParameters, std::string source = "")
+        : instructions(instructions), numLocals(numLocals), numParameters(numParameters), source(source) {}
+
+    ObjectType type() const override { return ObjectType::COMPILED_FUNCTION_OBJ; }
+    std::string inspect() const override { return source; }
+};
+
+class Closure : public Object {
+public:
+    std::shared_ptr<CompiledFunction> fn;
+    std::vector<Value> free;
+    Closure(std::shared_ptr<CompiledFunction> fn, std::vector<Value> free)
+        : fn(fn), free(free) {}
+
+    ObjectType type() const override { return ObjectType::CLOSURE_OBJ; }
+    std::string inspect() const override { return fn->inspect(); }
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,452 @@
+#include "optimizer.h"
+
+#include <limits>
+
+namespace optimizer {
+
+namespace {
+bool isLiteral(const ast::Expression* exp) {
+    return exp != nullptr && (exp->kind == ast::NodeKind::INTEGER_LITERAL || exp->kind == ast::NodeKind::BOOLEAN);
+}
+
+// The expression of a block that consists of a single expression statement,
+// or nullptr. Blocks do not open scopes, so such a block can be replaced by
+// its expression.
+ast::Expression* singleExpression(const ast::BlockStatement* block) {
+    if (block == nullptr || block->statements.size() != 1) {
+        return nullptr;
+    }
+    auto stmt = block->statements[0];
+    if (stmt->kind != ast::NodeKind::EXPRESSION_STATEMENT) {
+        return nullptr;
+    }
+    return static_cast<ast::ExpressionStatement*>(stmt)->expression;
+}
+}
+
+Optimizer::Optimizer(Options options) : options(options) {}
+
+Stats Optimizer::optimize(const std::shared_ptr<ast::Program>& program) {
+    stats = Stats{};
+    stats.nodesBefore = countNodes(program.get());
+    arena = &program->arena;
+
+    scopes.push_back(Scope{});
+    for (auto stmt : program->statements) {
+        collectStatement(stmt, scopes.back(), false);
+    }
+    for (auto stmt : program->statements) {
+        optimizeStatement(stmt, true);
+    }
+    scopes.clear();
+
+    arena = nullptr;
+    stats.nodesAfter = countNodes(program.get());
+    return stats;
+}
+
+// === Binding collection ===
+// Records every name a function body binds, without descending into
+// nested functions, so lookups know which scope a name belongs to before
+// its let has been reached.
+void Optimizer::collectStatement(ast::Statement* stmt, Scope& scope, bool conditional) {
+    switch (stmt->kind) {
+        case ast::NodeKind::LET_STATEMENT: {
+            auto letStmt = static_cast<ast::LetStatement*>(stmt);
+            collectExpression(letStmt->value, scope);
+            Binding& binding = scope.bindings[letStmt->name->value];
+            binding.lets++;
+            binding.conditional = binding.conditional || conditional;
+            break;
+        }
+        case ast::NodeKind::RETURN_STATEMENT:
+            collectExpression(static_cast<ast::ReturnStatement*>(stmt)->returnValue, scope);
+            break;
+        case ast::NodeKind::EXPRESSION_STATEMENT:
+            collectExpression(static_cast<ast::ExpressionStatement*>(stmt)->expression, scope);
+            break;
+        case ast::NodeKind::BLOCK_STATEMENT:
+            for (auto s : static_cast<ast::BlockStatement*>(stmt)->statements) {
+                collectStatement(s, scope, true);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Optimizer::collectExpression(ast::Expression* exp, Scope& scope) {
+    if (exp == nullptr) {
+        return;
+    }
+
+    switch (exp->kind) {
+        case ast::NodeKind::PREFIX_EXPRESSION:
+            collectExpression(static_cast<ast::PrefixExpression*>(exp)->right, scope);
+            break;
+        case ast::NodeKind::INFIX_EXPRESSION: {
+            auto infix = static_cast<ast::InfixExpression*>(exp);
+            collectExpression(infix->left, scope);
+            collectExpression(infix->right, scope);
+            break;
+        }
+        case ast::NodeKind::IF_EXPRESSION: {
+            auto ie = static_cast<ast::IfExpression*>(exp);
+            collectExpression(ie->condition, scope);
+            collectStatement(ie->consequence, scope, true);
+            if (ie->alternative != nullptr) {
+                collectStatement(ie->alternative, scope, true);
+            }
+            break;
+        }
+        case ast::NodeKind::CALL_EXPRESSION: {
+            auto call = static_cast<ast::CallExpression*>(exp);
+            collectExpression(call->function, scope);
+            for (auto arg : call->arguments) {
+                collectExpression(arg, scope);
+            }
+            break;
+        }
+        case ast::NodeKind::ARRAY_LITERAL:
+            for (auto element : static_cast<ast::ArrayLiteral*>(exp)->elements) {
+                collectExpression(element, scope);
+            }
+            break;
+        case ast::NodeKind::HASH_LITERAL:
+            for (auto part : static_cast<ast::HashLiteral*>(exp)->pairs) {
+                collectExpression(part, scope);
+            }
+            break;
+        case ast::NodeKind::INDEX_EXPRESSION: {
+            auto indexExp = static_cast<ast::IndexExpression*>(exp);
+            collectExpression(indexExp->left, scope);
+            collectExpression(indexExp->index, scope);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// === Rewriting ===
+// `direct` is set for statements that sit directly in a function body or
+// at the top level of the program.
+void Optimizer::optimizeStatement(ast::Statement* stmt, bool direct) {
+    switch (stmt->kind) {
+        case ast::NodeKind::LET_STATEMENT: {
+            auto letStmt = static_cast<ast::LetStatement*>(stmt);
+            letStmt->value = optimizeExpression(letStmt->value);
+
+            bool global = scopes.size() == 1;
+            Binding& binding = scopes.back().bindings[letStmt->name->value];
+            if (direct && isLiteral(letStmt->value) && binding.lets == 1 && !binding.conditional && !binding.parameter
+                && (!global || options.propagateGlobals)) {
+                binding.constant = letStmt->value;
+            }
+            break;
+        }
+        case ast::NodeKind::RETURN_STATEMENT: {
+            auto ret = static_cast<ast::ReturnStatement*>(stmt);
+            ret->returnValue = optimizeExpression(ret->returnValue);
+            break;
+        }
+        case ast::NodeKind::EXPRESSION_STATEMENT: {
+            auto es = static_cast<ast::ExpressionStatement*>(stmt);
+            es->expression = optimizeExpression(es->expression);
+            break;
+        }
+        case ast::NodeKind::BLOCK_STATEMENT:
+            optimizeBlock(static_cast<ast::BlockStatement*>(stmt));
+            break;
+        default:
+            break;
+    }
+}
+
+void Optimizer::optimizeBlock(ast::BlockStatement* block) {
+    for (auto stmt : block->statements) {
+        optimizeStatement(stmt, false);
+    }
+}
+
+ast::Expression* Optimizer::optimizeExpression(ast::Expression* exp) {
+    if (exp == nullptr) {
+        return nullptr;
+    }
+
+    switch (exp->kind) {
+        case ast::NodeKind::IDENTIFIER: {
+            auto constant = lookupConstant(static_cast<ast::Identifier*>(exp));
+            if (constant != nullptr) {
+                stats.propagated++;
+                return constant;
+            }
+            return exp;
+        }
+        case ast::NodeKind::PREFIX_EXPRESSION: {
+            auto prefix = static_cast<ast::PrefixExpression*>(exp);
+            prefix->right = optimizeExpression(prefix->right);
+            return foldPrefix(prefix);
+        }
+        case ast::NodeKind::INFIX_EXPRESSION: {
+            auto infix = static_cast<ast::InfixExpression*>(exp);
+            infix->left = optimizeExpression(infix->left);
+            infix->right = optimizeExpression(infix->right);
+            return foldInfix(infix);
+        }
+        case ast::NodeKind::IF_EXPRESSION: {
+            auto ie = static_cast<ast::IfExpression*>(exp);
+            ie->condition = optimizeExpression(ie->condition);
+            return foldIf(ie);
+        }
+        case ast::NodeKind::FUNCTION_LITERAL:
+            return optimizeFunction(static_cast<ast::FunctionLiteral*>(exp));
+        case ast::NodeKind::CALL_EXPRESSION: {
+            auto call = static_cast<ast::CallExpression*>(exp);
+            call->function = optimizeExpression(call->function);
+            for (size_t i = 0; i < call->arguments.size(); i++) {
+                call->arguments.set(i, optimizeExpression(call->arguments[i]));
+            }
+            return call;
+        }
+        case ast::NodeKind::ARRAY_LITERAL: {
+            auto array = static_cast<ast::ArrayLiteral*>(exp);
+            for (size_t i = 0; i < array->elements.size(); i++) {
+                array->elements.set(i, optimizeExpression(array->elements[i]));
+            }
+            return array;
+        }
+        case ast::NodeKind::HASH_LITERAL: {
+            auto hash = static_cast<ast::HashLiteral*>(exp);
+            for (size_t i = 0; i < hash->pairs.size(); i++) {
+                hash->pairs.set(i, optimizeExpression(hash->pairs[i]));
+            }
+            return hash;
+        }
+        case ast::NodeKind::INDEX_EXPRESSION: {
+            auto indexExp = static_cast<ast::IndexExpression*>(exp);
+            indexExp->left = optimizeExpression(indexExp->left);
+            indexExp->index = optimizeExpression(indexExp->index);
+            return indexExp;
+        }
+        default:
+            return exp;
+    }
+}
+
+ast::Expression* Optimizer::optimizeFunction(ast::FunctionLiteral* fn) {
+    scopes.push_back(Scope{});
+    Scope& scope = scopes.back();
+    for (auto param : fn->parameters) {
+        scope.bindings[param->value].parameter = true;
+    }
+    for (auto stmt : fn->body->statements) {
+        collectStatement(stmt, scope, false);
+    }
+
+    for (auto stmt : fn->body->statements) {
+        optimizeStatement(stmt, true);
+    }
+    scopes.pop_back();
+    return fn;
+}
+
+// Mirrors evaluator::evalPrefixExpression; operands the evaluator would
+// reject are left for it to report.
+ast::Expression* Optimizer::foldPrefix(ast::PrefixExpression* prefix) {
+    auto right = prefix->right;
+    if (!isLiteral(right)) {
+        return prefix;
+    }
+
+    if (prefix->op == ast::Operator::BANG) {
+        bool value = right->kind == ast::NodeKind::BOOLEAN && !static_cast<ast::Boolean*>(right)->value;
+        stats.folded++;
+        return arena->make<ast::Boolean>(value);
+    }
+    if (prefix->op == ast::Operator::MINUS && right->kind == ast::NodeKind::INTEGER_LITERAL) {
+        int64_t value = static_cast<ast::IntegerLiteral*>(right)->value;
+        if (value == std::numeric_limits<int64_t>::min()) {
+            return prefix;
+        }
+        stats.folded++;
+        return arena->make<ast::IntegerLiteral>(-value);
+    }
+    return prefix;
+}
+
+// Mirrors evaluator::evalInfixExpression.
+ast::Expression* Optimizer::foldInfix(ast::InfixExpression* infix) {
+    auto left = infix->left;
+    auto right = infix->right;
+    if (!isLiteral(left) || !isLiteral(right)) {
+        return infix;
+    }
+    ast::Operator op = infix->op;
+
+    if (left->kind == ast::NodeKind::INTEGER_LITERAL && right->kind == ast::NodeKind::INTEGER_LITERAL) {
+        int64_t l = static_cast<ast::IntegerLiteral*>(left)->value;
+        int64_t r = static_cast<ast::IntegerLiteral*>(right)->value;
+
+        if (op == ast::Operator::SLASH && (r == 0 || (l == std::numeric_limits<int64_t>::min() && r == -1))) {
+            return infix;
+        }
+        // results that overflow are left for the evaluator too
+        int64_t result = 0;
+        ast::Expression* folded = nullptr;
+        switch (op) {
+            case ast::Operator::PLUS:
+                if (!__builtin_add_overflow(l, r, &result)) {
+                    folded = arena->make<ast::IntegerLiteral>(result);
+                }
+                break;
+            case ast::Operator::MINUS:
+                if (!__builtin_sub_overflow(l, r, &result)) {
+                    folded = arena->make<ast::IntegerLiteral>(result);
+                }
+                break;
+            case ast::Operator::ASTERISK:
+                if (!__builtin_mul_overflow(l, r, &result)) {
+                    folded = arena->make<ast::IntegerLiteral>(result);
+                }
+                break;
+            case ast::Operator::SLASH: folded = arena->make<ast::IntegerLiteral>(l / r); break;
+            case ast::Operator::LT: folded = arena->make<ast::Boolean>(l < r); break;
+            case ast::Operator::GT: folded = arena->make<ast::Boolean>(l > r); break;
+            case ast::Operator::EQ: folded = arena->make<ast::Boolean>(l == r); break;
+            case ast::Operator::NOT_EQ: folded = arena->make<ast::Boolean>(l != r); break;
+            case ast::Operator::BANG: break;
+        }
+        if (folded != nullptr) {
+            stats.folded++;
+        }
+        return folded != nullptr ? folded : infix;
+    }
+
+    if (op == ast::Operator::EQ || op == ast::Operator::NOT_EQ) {
+        // an integer never equals a boolean; two booleans compare by value
+        bool equal = left->kind == right->kind
+            && static_cast<ast::Boolean*>(left)->value == static_cast<ast::Boolean*>(right)->value;
+        stats.folded++;
+        return arena->make<ast::Boolean>(op == ast::Operator::EQ ? equal : !equal);
+    }
+    return infix;
+}
+
+ast::Expression* Optimizer::foldIf(ast::IfExpression* ie) {
+    if (!isLiteral(ie->condition)) {
+        optimizeBlock(ie->consequence);
+        if (ie->alternative != nullptr) {
+            optimizeBlock(ie->alternative);
+        }
+        return ie;
+    }
+
+    // integers are always truthy
+    bool truthy = ie->condition->kind == ast::NodeKind::INTEGER_LITERAL || static_cast<ast::Boolean*>(ie->condition)->value;
+    ast::BlockStatement* taken = truthy ? ie->consequence : ie->alternative;
+    stats.branchesRemoved++;
+
+    if (taken == nullptr) {
+        // `if (false) { ... }` evaluates to null
+        ie->consequence = arena->make<ast::BlockStatement>(ast::NodeList<ast::Statement>());
+        ie->alternative = nullptr;
+        return ie;
+    }
+
+    optimizeBlock(taken);
+    if (auto exp = singleExpression(taken)) {
+        return exp;
+    }
+    ie->condition = arena->make<ast::Boolean>(true);
+    ie->consequence = taken;
+    ie->alternative = nullptr;
+    return ie;
+}
+
+ast::Expression* Optimizer::lookupConstant(const ast::Identifier* ident) const {
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+        auto found = it->bindings.find(ident->value);
+        if (found != it->bindings.end()) {
+            // the innermost binding of the name decides, constant or not
+            return found->second.constant;
+        }
+    }
+    return nullptr;
+}
+
+// === Node counting ===
+int countNodes(const ast::Node* node) {
+    if (node == nullptr) {
+        return 0;
+    }
+
+    switch (node->kind) {
+        case ast::NodeKind::PROGRAM: {
+            int count = 1;
+            for (auto stmt : static_cast<const ast::Program*>(node)->statements) {
+                count += countNodes(stmt);
+            }
+            return count;
+        }
+        case ast::NodeKind::LET_STATEMENT: {
+            auto letStmt = static_cast<const ast::LetStatement*>(node);
+            return 1 + countNodes(letStmt->name) + countNodes(letStmt->value);
+        }
+        case ast::NodeKind::RETURN_STATEMENT:
+            return 1 + countNodes(static_cast<const ast::ReturnStatement*>(node)->returnValue);
+        case ast::NodeKind::EXPRESSION_STATEMENT:
+            return 1 + countNodes(static_cast<const ast::ExpressionStatement*>(node)->expression);
+        case ast::NodeKind::PREFIX_EXPRESSION:
+            return 1 + countNodes(static_cast<const ast::PrefixExpression*>(node)->right);
+        case ast::NodeKind::INFIX_EXPRESSION: {
+            auto infix = static_cast<const ast::InfixExpression*>(node);
+            return 1 + countNodes(infix->left) + countNodes(infix->right);
+        }
+        case ast::NodeKind::BLOCK_STATEMENT: {
+            int count = 1;
+            for (auto stmt : static_cast<const ast::BlockStatement*>(node)->statements) {
+                count += countNodes(stmt);
+            }
+            return count;
+        }
+        case ast::NodeKind::IF_EXPRESSION: {
+            auto ie = static_cast<const ast::IfExpression*>(node);
+            return 1 + countNodes(ie->condition) + countNodes(ie->consequence) + countNodes(ie->alternative);
+        }
+        case ast::NodeKind::FUNCTION_LITERAL: {
+            auto fn = static_cast<const ast::FunctionLiteral*>(node);
+            return 1 + static_cast<int>(fn->parameters.size()) + countNodes(fn->body);
+        }
+        case ast::NodeKind::CALL_EXPRESSION: {
+            auto call = static_cast<const ast::CallExpression*>(node);
+            int count = 1 + countNodes(call->function);
+            for (auto arg : call->arguments) {
+                count += countNodes(arg);
+            }
+            return count;
+        }
+        case ast::NodeKind::ARRAY_LITERAL: {
+            int count = 1;
+            for (auto element : static_cast<const ast::ArrayLiteral*>(node)->elements) {
+                count += countNodes(element);
+            }
+            return count;
+        }
+        case ast::NodeKind::HASH_LITERAL: {
+            int count = 1;
+            for (auto part : static_cast<const ast::HashLiteral*>(node)->pairs) {
+                count += countNodes(part);
+            }
+            return count;
+        }
+        case ast::NodeKind::INDEX_EXPRESSION: {
+            auto indexExp = static_cast<const ast::IndexExpression*>(node);
+            return 1 + countNodes(indexExp->left) + countNodes(indexExp->index);
+        }
+        default:
+            return 1;
+    }
+}
+
+}
\ No newline at end of file
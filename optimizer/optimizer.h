@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../ast/ast.h"
+
+namespace optimizer {
+
+struct Options {
+    // Propagate constants bound by top-level lets. Only safe when the
+    // program is the whole script: in the REPL a later line may re-bind
+    // a global that functions from this line refer to.
+    bool propagateGlobals = false;
+};
+
+struct Stats {
+    int nodesBefore = 0;
+    int nodesAfter = 0;
+    int folded = 0;          // prefix and infix expressions computed
+    int branchesRemoved = 0; // if expressions with a constant condition
+    int propagated = 0;      // identifiers replaced by their constant value
+
+    int eliminated() const { return nodesBefore - nodesAfter; }
+};
+
+// Optional pass run between parsing and resolution. It rewrites the tree
+// in place, allocating replacement nodes in the program's arena:
+//
+// - prefix and infix expressions over integer and boolean literals are
+//   folded, unless evaluating them would fail (e.g. division by zero)
+// - if expressions with a literal condition lose their dead branch
+// - identifiers bound once by a let to a literal are replaced by it
+//
+// A let counts as constant only if it is the sole binding of its name in
+// its function, and sits directly in the function body rather than in an
+// if branch, so the name is always bound to that value once it has run.
+class Optimizer {
+public:
+    explicit Optimizer(Options options = Options());
+
+    Stats optimize(const std::shared_ptr<ast::Program>& program);
+
+private:
+    struct Binding {
+        int lets = 0;
+        bool conditional = false; // bound by a let inside an if branch
+        bool parameter = false;
+        ast::Expression* constant = nullptr; // set once the let has been passed
+    };
+
+    struct Scope {
+        std::unordered_map<std::string_view, Binding> bindings;
+    };
+
+    Options options;
+    Stats stats;
+    ast::Arena* arena = nullptr;
+    std::vector<Scope> scopes; // the global scope first, innermost function last
+
+    void collectStatement(ast::Statement* stmt, Scope& scope, bool conditional);
+    void collectExpression(ast::Expression* exp, Scope& scope);
+
+    void optimizeStatement(ast::Statement* stmt, bool direct);
+    void optimizeBlock(ast::BlockStatement* block);
+    ast::Expression* optimizeExpression(ast::Expression* exp);
+    ast::Expression* optimizeFunction(ast::FunctionLiteral* fn);
+    ast::Expression* foldPrefix(ast::PrefixExpression* prefix);
+    ast::Expression* foldInfix(ast::InfixExpression* infix);
+    ast::Expression* foldIf(ast::IfExpression* ie);
+    ast::Expression* lookupConstant(const ast::Identifier* ident) const;
+};
+
+// Number of nodes reachable from `node`, the node itself included.
+int countNodes(const ast::Node* node);
+
+}
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../gc/gc.h"
+#include "../stats/stats.h"
+
+namespace parallel {
+
+namespace {
+thread_local bool poolThread = false;
+thread_local bool runningChunk = false; // on the caller, while it works on its own batch
+
+size_t configuredThreads = 0; // 0: one per hardware thread
+
+// Held by the thread whose batch the pool is running. The pool runs one
+// batch at a time, e.g. for one of several isolates.
+std::mutex batch;
+
+// The chunks queued on one thread. The owner takes them from the front and
+// thieves from the back, so they rarely want the same end.
+class WorkQueue {
+public:
+    void push(size_t chunk) {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunks.push_back(chunk);
+    }
+
+    bool pop(size_t& chunk) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (chunks.empty()) {
+            return false;
+        }
+        chunk = chunks.front();
+        chunks.pop_front();
+        return true;
+    }
+
+    bool steal(size_t& chunk) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (chunks.empty()) {
+            return false;
+        }
+        chunk = chunks.back();
+        chunks.pop_back();
+        return true;
+    }
+
+private:
+    std::mutex mutex;
+    std::deque<size_t> chunks;
+};
+
+class Pool {
+public:
+    // Queue 0 belongs to the calling thread, the others to the workers.
+    explicit Pool(size_t threads) : queues(threads), heaps(threads, nullptr), counters(threads, nullptr) {
+        for (size_t i = 1; i < threads; i++) {
+            workers.emplace_back([this, i]() { work(i); });
+        }
+    }
+
+    ~Pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    size_t size() const { return queues.size(); }
+
+    void run(size_t chunks, const std::function<void(size_t)>& body) {
+        // Each thread starts with a contiguous run of chunks.
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            queues[chunk * queues.size() / chunks].push(chunk);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &body;
+            remaining = chunks;
+            threshold = gc::current().getThreshold();
+            generation++;
+        }
+        wake.notify_all();
+
+        runningChunk = true;
+        drain(0, body);
+        runningChunk = false;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return remaining == 0 && active == 0; });
+        current = nullptr;
+        // The workers are idle now; what they allocated and still lives is
+        // referred to from this thread only.
+        for (gc::Heap* heap : heaps) {
+            if (heap != nullptr) {
+                gc::current().adopt(*heap);
+            }
+        }
+        for (stats::Counters* workerCounters : counters) {
+            if (workerCounters != nullptr) {
+                stats::current().adopt(*workerCounters);
+            }
+        }
+    }
+
+private:
+    void work(size_t self) {
+        poolThread = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            heaps[self] = &gc::heap;
+            counters[self] = &stats::counters;
+        }
+        uint64_t seen = 0;
+        while (true) {
+            const std::function<void(size_t)>* body;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                if (current == nullptr) {
+                    continue; // finished before this thread woke up
+                }
+                body = current;
+                active++;
+                gc::heap.setThreshold(threshold);
+            }
+            drain(self, *body);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                active--;
+            }
+            done.notify_all();
+        }
+    }
+
+    void drain(size_t self, const std::function<void(size_t)>& body) {
+        size_t chunk;
+        while (take(self, chunk)) {
+            body(chunk);
+            if (remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+
+    bool take(size_t self, size_t& chunk) {
+        if (queues[self].pop(chunk)) {
+            return true;
+        }
+        for (size_t i = 1; i < queues.size(); i++) {
+            if (queues[(self + i) % queues.size()].steal(chunk)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<WorkQueue> queues;
+    std::vector<gc::Heap*> heaps; // each worker's heap, once it has started
+    std::vector<stats::Counters*> counters; // and its allocation statistics
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake; // a batch started, or the pool is stopping
+    std::condition_variable done; // a batch may have finished
+    const std::function<void(size_t)>* current = nullptr;
+    std::atomic<size_t> remaining{0};
+    size_t active = 0; // workers inside the current batch
+    size_t threshold = gc::Heap::DEFAULT_THRESHOLD;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+Pool& pool() {
+    static Pool instance(threadCount());
+    return instance;
+}
+}
+
+void setThreadCount(size_t threads) {
+    configuredThreads = threads;
+}
+
+size_t threadCount() {
+    if (configuredThreads > 0) {
+        return configuredThreads;
+    }
+    size_t hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? hardware : 1;
+}
+
+bool onPoolThread() {
+    return poolThread;
+}
+
+void forEachChunk(size_t chunks, const std::function<void(size_t)>& body) {
+    std::unique_lock<std::mutex> lock(batch, std::defer_lock);
+    if (poolThread || runningChunk || chunks <= 1 || threadCount() <= 1 || !lock.try_lock()) {
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            body(chunk);
+        }
+        return;
+    }
+    pool().run(chunks, body);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace parallel {
+
+// A work-stealing thread pool for the parallel builtins (pmap, preduce).
+// Work is split into a fixed number of chunks. Each thread takes chunks
+// from the front of its own queue and, when that runs dry, steals from the
+// back of another thread's queue. The calling thread works on its batch
+// too, so a pool of N threads starts N - 1 of its own.
+//
+// Pool threads evaluate with their own gc::Heap and stats::Counters; the
+// caller adopts what they allocated, and the counts, once the batch is
+// done.
+
+// Threads used by a batch, counting the caller. Defaults to the number of
+// hardware threads. Only takes effect before the first batch.
+void setThreadCount(size_t threads);
+size_t threadCount();
+
+// True on the pool's own threads, which must not touch state the caller's
+// thread owns, such as call site caches and memo tables.
+bool onPoolThread();
+
+// Calls body(i) for every i in [0, chunks) and returns when all calls are
+// done. Called from a pool thread, or while another thread's batch is
+// running, it runs the chunks in order on the calling thread instead.
+void forEachChunk(size_t chunks, const std::function<void(size_t)>& body);
+
+}
\ No newline at end of file
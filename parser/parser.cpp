@@ -1,89 +1,136 @@
 #include "parser.h"
 
+#include <charconv>
+
 namespace parser{
 namespace {
-std::unordered_map<token::TokenType, Precedence> precedences = {
-    {token::TokenType::EQ, EQUALS},
-    {token::TokenType::NOT_EQ, EQUALS},
-    {token::TokenType::LT, LESSGREATER},
-    {token::TokenType::GT, LESSGREATER},
-    {token::TokenType::PLUS, SUM},
-    {token::TokenType::MINUS, SUM},
-    {token::TokenType::SLASH, PRODUCT},
-    {token::TokenType::ASTERISK, PRODUCT},
-    {token::TokenType::LPAREN, CALL},
-};
+constexpr size_t index(token::TokenType type) {
+    return static_cast<size_t>(type);
+}
+
+constexpr std::array<Precedence, token::TOKEN_TYPE_COUNT> makePrecedences() {
+    std::array<Precedence, token::TOKEN_TYPE_COUNT> table{}; // LOWEST
+    table[index(token::TokenType::EQ)] = EQUALS;
+    table[index(token::TokenType::NOT_EQ)] = EQUALS;
+    table[index(token::TokenType::LT)] = LESSGREATER;
+    table[index(token::TokenType::GT)] = LESSGREATER;
+    table[index(token::TokenType::PLUS)] = SUM;
+    table[index(token::TokenType::MINUS)] = SUM;
+    table[index(token::TokenType::SLASH)] = PRODUCT;
+    table[index(token::TokenType::ASTERISK)] = PRODUCT;
+    table[index(token::TokenType::LPAREN)] = CALL;
+    table[index(token::TokenType::LBRACKET)] = INDEX;
+    return table;
+}
+
+constexpr std::array<Precedence, token::TOKEN_TYPE_COUNT> precedences = makePrecedences();
+
+// Only called for the tokens the parse tables map to prefix and infix
+// expressions, which are all operators.
+ast::Operator operatorOf(token::TokenType type) {
+    switch (type) {
+        case token::TokenType::PLUS: return ast::Operator::PLUS;
+        case token::TokenType::MINUS: return ast::Operator::MINUS;
+        case token::TokenType::ASTERISK: return ast::Operator::ASTERISK;
+        case token::TokenType::SLASH: return ast::Operator::SLASH;
+        case token::TokenType::BANG: return ast::Operator::BANG;
+        case token::TokenType::LT: return ast::Operator::LT;
+        case token::TokenType::GT: return ast::Operator::GT;
+        case token::TokenType::EQ: return ast::Operator::EQ;
+        default: return ast::Operator::NOT_EQ;
+    }
+}
 }
 
+constexpr PrefixParseTable Parser::makePrefixParseFns() {
+    PrefixParseTable table{};
+    table[index(token::TokenType::IDENT)] = &Parser::parseIdentifier;
+    table[index(token::TokenType::INT)] = &Parser::parseIntegerLiteral;
+    table[index(token::TokenType::STRING)] = &Parser::parseStringLiteral;
+    table[index(token::TokenType::BANG)] = &Parser::parsePrefixExpression;
+    table[index(token::TokenType::MINUS)] = &Parser::parsePrefixExpression;
+    table[index(token::TokenType::TRUE)] = &Parser::parseBoolean;
+    table[index(token::TokenType::FALSE)] = &Parser::parseBoolean;
+    table[index(token::TokenType::LPAREN)] = &Parser::parseGroupedExpression;
+    table[index(token::TokenType::IF)] = &Parser::parseIfExpression;
+    table[index(token::TokenType::FUNCTION)] = &Parser::parseFunctionLiteral;
+    table[index(token::TokenType::MEMO)] = &Parser::parseMemoFunctionLiteral;
+    table[index(token::TokenType::LBRACKET)] = &Parser::parseArrayLiteral;
+    table[index(token::TokenType::LBRACE)] = &Parser::parseHashLiteral;
+    return table;
+}
+
+constexpr InfixParseTable Parser::makeInfixParseFns() {
+    InfixParseTable table{};
+    table[index(token::TokenType::PLUS)] = &Parser::parseInfixExpression;
+    table[index(token::TokenType::MINUS)] = &Parser::parseInfixExpression;
+    table[index(token::TokenType::ASTERISK)] = &Parser::parseInfixExpression;
+    table[index(token::TokenType::SLASH)] = &Parser::parseInfixExpression;
+    table[index(token::TokenType::EQ)] = &Parser::parseInfixExpression;
+    table[index(token::TokenType::NOT_EQ)] = &Parser::parseInfixExpression;
+    table[index(token::TokenType::LT)] = &Parser::parseInfixExpression;
+    table[index(token::TokenType::GT)] = &Parser::parseInfixExpression;
+    table[index(token::TokenType::LPAREN)] = &Parser::parseCallExpression;
+    table[index(token::TokenType::LBRACKET)] = &Parser::parseIndexExpression;
+    return table;
+}
+
+constexpr PrefixParseTable Parser::prefixParseFns = Parser::makePrefixParseFns();
+constexpr InfixParseTable Parser::infixParseFns = Parser::makeInfixParseFns();
+
 Parser::Parser(std::shared_ptr<lexer::Lexer> l) : l(l) {
     Parser::nextToken();
     Parser::nextToken();
-
-    registerPrefix(token::TokenType::IDENT, [this]() { return parseIdentifier(); });
-    registerPrefix(token::TokenType::INT, [this]() { return parseIntegerLiteral(); });
-    registerPrefix(token::TokenType::BANG, [this]() { return parsePrefixExpression(); });
-    registerPrefix(token::TokenType::MINUS, [this]() { return parsePrefixExpression(); });
-    registerPrefix(token::TokenType::TRUE, [this]() { return parseBoolean(); });
-    registerPrefix(token::TokenType::FALSE, [this]() { return parseBoolean(); });
-    registerPrefix(token::TokenType::LPAREN, [this]() { return parseGroupedExpression(); });
-    registerPrefix(token::TokenType::IF, [this]() { return parseIfExpression(); });
-    registerPrefix(token::TokenType::FUNCTION, [this]() { return parseFunctionLiteral(); });
-
-    registerInfix(token::TokenType::PLUS, [this](std::shared_ptr<ast::Expression> left) { return parseInfixExpression(left); });
-    registerInfix(token::TokenType::MINUS, [this](std::shared_ptr<ast::Expression> left) { return parseInfixExpression(left); });
-    registerInfix(token::TokenType::ASTERISK, [this](std::shared_ptr<ast::Expression> left) { return parseInfixExpression(left); });
-    registerInfix(token::TokenType::SLASH, [this](std::shared_ptr<ast::Expression> left) { return parseInfixExpression(left); });
-    registerInfix(token::TokenType::EQ, [this](std::shared_ptr<ast::Expression> left) { return parseInfixExpression(left); });
-    registerInfix(token::TokenType::NOT_EQ, [this](std::shared_ptr<ast::Expression> left) { return parseInfixExpression(left); });
-    registerInfix(token::TokenType::LT, [this](std::shared_ptr<ast::Expression> left) { return parseInfixExpression(left); });
-    registerInfix(token::TokenType::GT, [this](std::shared_ptr<ast::Expression> left) { return parseInfixExpression(left); });
-    registerInfix(token::TokenType::LPAREN, [this](std::shared_ptr<ast::Expression> left) { return parseCallExpression(left); });
 }
 
 int Parser::peekPrecedence() const {
-    auto it = precedences.find(peekToken.type);
-    return (it != precedences.end()) ? it->second : LOWEST;
+    return precedences[index(peekToken.type)];
 }
 
 int Parser::curPrecedence() const {
-    auto it = precedences.find(curToken.type);
-    return (it != precedences.end()) ? it->second : LOWEST;
+    return precedences[index(curToken.type)];
 }
 
-std::shared_ptr<ast::Expression> Parser::parseIdentifier() {
-    return std::make_shared<ast::Identifier>(curToken, curToken.literal);
+ast::Expression* Parser::parseIdentifier() {
+    return program->arena.make<ast::Identifier>(program->arena.copyString(curToken.literal));
 }
 
-std::shared_ptr<ast::Expression> Parser::parseBoolean() {
-    return std::make_shared<ast::Boolean>(curToken, curTokenIs(token::TokenType::TRUE));
+ast::Expression* Parser::parseBoolean() {
+    return program->arena.make<ast::Boolean>(curTokenIs(token::TokenType::TRUE));
 }
 
-std::shared_ptr<ast::Expression> Parser::parseIntegerLiteral() {
-    try {
-        int64_t value = std::stoll(curToken.literal);
-        return std::make_shared<ast::IntegerLiteral>(curToken, value);
-    } catch (...) {
-        errorMessages.push_back("could not parse " + curToken.literal + " as integer");
+ast::Expression* Parser::parseIntegerLiteral() {
+    const char* first = curToken.literal.data();
+    const char* last = first + curToken.literal.size();
+    int64_t value = 0;
+    auto result = std::from_chars(first, last, value);
+    if (result.ec != std::errc() || result.ptr != last) {
+        errorMessages.push_back("could not parse " + std::string(curToken.literal) + " as integer");
         return nullptr;
     }
+    return program->arena.make<ast::IntegerLiteral>(value);
 }
 
-std::shared_ptr<ast::Expression> Parser::parsePrefixExpression() {
-    auto expression = std::make_shared<ast::PrefixExpression>(curToken, curToken.literal, nullptr);
+ast::Expression* Parser::parseStringLiteral() {
+    return program->arena.make<ast::StringLiteral>(program->arena.copyString(curToken.literal), program->newConstant());
+}
+
+ast::Expression* Parser::parsePrefixExpression() {
+    auto expression = program->arena.make<ast::PrefixExpression>(operatorOf(curToken.type), nullptr);
     nextToken();
     expression->right = parseExpression(PREFIX);
     return expression;
 }
 
-std::shared_ptr<ast::Expression> Parser::parseInfixExpression(std::shared_ptr<ast::Expression> left) {
-    auto expression = std::make_shared<ast::InfixExpression>(curToken, left, curToken.literal, nullptr);
+ast::Expression* Parser::parseInfixExpression(ast::Expression* left) {
+    auto expression = program->arena.make<ast::InfixExpression>(left, operatorOf(curToken.type), nullptr);
     int precedence = curPrecedence();
     nextToken();
     expression->right = parseExpression(precedence);
     return expression;
 }
 
-std::shared_ptr<ast::Expression> Parser::parseGroupedExpression() {
+ast::Expression* Parser::parseGroupedExpression() {
     nextToken();
     auto exp = parseExpression(LOWEST);
     if (!expectPeek(token::TokenType::RPAREN)) {
@@ -92,8 +139,8 @@ std::shared_ptr<ast::Expression> Parser::parseGroupedExpression() {
     return exp;
 }
 
-std::shared_ptr<ast::Expression> Parser::parseIfExpression() {
-    auto expression = std::make_shared<ast::IfExpression>(curToken, nullptr, nullptr, nullptr);
+ast::Expression* Parser::parseIfExpression() {
+    auto expression = program->arena.make<ast::IfExpression>(nullptr, nullptr, nullptr);
     if (!expectPeek(token::TokenType::LPAREN)) {
         return nullptr;
     }
@@ -118,22 +165,24 @@ std::shared_ptr<ast::Expression> Parser::parseIfExpression() {
     return expression;
 }
 
-std::shared_ptr<ast::BlockStatement> Parser::parseBlockStatement() {
-    auto block = std::make_shared<ast::BlockStatement>(curToken, std::vector<std::shared_ptr<ast::Statement>>());
+ast::BlockStatement* Parser::parseBlockStatement() {
+    size_t mark = scratch.size();
     nextToken();
 
     while(!curTokenIs(token::TokenType::RBRACE) && !curTokenIs(token::TokenType::EOF_TOKEN)) {
         auto stmt = parseStatement();
         if (stmt != nullptr) {
-            block->statements.push_back(stmt);
+            scratch.push_back(stmt);
         }
         nextToken();
     }
+    auto block = program->arena.make<ast::BlockStatement>(program->arena.makeList<ast::Statement>(scratch, mark));
+    scratch.resize(mark);
     return block;
 }
 
-std::shared_ptr<ast::Expression> Parser::parseFunctionLiteral() {
-    auto lit = std::make_shared<ast::FunctionLiteral>(curToken, std::vector<std::shared_ptr<ast::Identifier>>(), nullptr);
+ast::Expression* Parser::parseFunctionLiteral() {
+    auto lit = program->arena.make<ast::FunctionLiteral>(ast::NodeList<ast::Identifier>(), nullptr, program);
     if (!expectPeek(token::TokenType::LPAREN)) {
         return nullptr;
     }
@@ -147,56 +196,109 @@ std::shared_ptr<ast::Expression> Parser::parseFunctionLiteral() {
     return lit;
 }
 
-std::vector<std::shared_ptr<ast::Identifier>> Parser::parseFunctionParameters() {
-    std::vector<std::shared_ptr<ast::Identifier>> identifiers;
+ast::Expression* Parser::parseMemoFunctionLiteral() {
+    if (!expectPeek(token::TokenType::FUNCTION)) {
+        return nullptr;
+    }
+    auto lit = static_cast<ast::FunctionLiteral*>(parseFunctionLiteral());
+    if (lit != nullptr) {
+        lit->memoized = true;
+    }
+    return lit;
+}
+
+ast::NodeList<ast::Identifier> Parser::parseFunctionParameters() {
     if (peekTokenIs(token::TokenType::RPAREN)) {
         nextToken();
-        return identifiers;
+        return {};
     }
     nextToken();
 
-    auto ident = std::make_shared<ast::Identifier>(curToken, curToken.literal);
-    identifiers.push_back(ident);
+    size_t mark = scratch.size();
+    scratch.push_back(parseIdentifier());
 
     while(peekTokenIs(token::TokenType::COMMA)) {
         nextToken();
         nextToken();
-        ident = std::make_shared<ast::Identifier>(curToken, curToken.literal);
-        identifiers.push_back(ident);
+        scratch.push_back(parseIdentifier());
     }
 
     if (!expectPeek(token::TokenType::RPAREN)) {
+        scratch.resize(mark);
         return {};
     }
+    auto identifiers = program->arena.makeList<ast::Identifier>(scratch, mark);
+    scratch.resize(mark);
     return identifiers;
 }
 
-std::shared_ptr<ast::Expression> Parser::parseCallExpression(std::shared_ptr<ast::Expression> function) {
-    auto exp = std::make_shared<ast::CallExpression>(curToken, function, std::vector<std::shared_ptr<ast::Expression>>());
-    exp->arguments = parseCallArguments();
-    return exp;
+ast::Expression* Parser::parseCallExpression(ast::Expression* function) {
+    auto arguments = parseExpressionList(token::TokenType::RPAREN);
+    return program->arena.make<ast::CallExpression>(function, arguments, program->newCallSite());
 }
 
-std::vector<std::shared_ptr<ast::Expression>> Parser::parseCallArguments() {
-    std::vector<std::shared_ptr<ast::Expression>> args;
-    if (peekTokenIs(token::TokenType::RPAREN)) {
+ast::Expression* Parser::parseArrayLiteral() {
+    return program->arena.make<ast::ArrayLiteral>(parseExpressionList(token::TokenType::RBRACKET));
+}
+
+ast::Expression* Parser::parseIndexExpression(ast::Expression* left) {
+    nextToken();
+    auto index = parseExpression(LOWEST);
+    if (!expectPeek(token::TokenType::RBRACKET)) {
+        return nullptr;
+    }
+    return program->arena.make<ast::IndexExpression>(left, index);
+}
+
+// `{k: v, ...}`. The pairs are collected in the scratch buffer like any
+// other list, key before value.
+ast::Expression* Parser::parseHashLiteral() {
+    size_t mark = scratch.size();
+    while (!peekTokenIs(token::TokenType::RBRACE)) {
         nextToken();
-        return args;
+        scratch.push_back(parseExpression(LOWEST));
+        if (!expectPeek(token::TokenType::COLON)) {
+            scratch.resize(mark);
+            return nullptr;
+        }
+        nextToken();
+        scratch.push_back(parseExpression(LOWEST));
+        if (!peekTokenIs(token::TokenType::RBRACE) && !expectPeek(token::TokenType::COMMA)) {
+            scratch.resize(mark);
+            return nullptr;
+        }
+    }
+    nextToken();
+    auto pairs = program->arena.makeList<ast::Expression>(scratch, mark);
+    scratch.resize(mark);
+    return program->arena.make<ast::HashLiteral>(pairs);
+}
+
+// Comma-separated expressions up to the closing `end` token: call
+// arguments and array elements.
+ast::NodeList<ast::Expression> Parser::parseExpressionList(token::TokenType end) {
+    if (peekTokenIs(end)) {
+        nextToken();
+        return {};
     }
 
     nextToken();
-    args.push_back(parseExpression(LOWEST));
+    size_t mark = scratch.size();
+    scratch.push_back(parseExpression(LOWEST));
 
     while(peekTokenIs(token::TokenType::COMMA)) {
         nextToken();
         nextToken();
-        args.push_back(parseExpression(LOWEST));
+        scratch.push_back(parseExpression(LOWEST));
     }
 
-    if (!expectPeek(token::TokenType::RPAREN)) {
+    if (!expectPeek(end)) {
+        scratch.resize(mark);
         return {};
     }
-    return args;
+    auto list = program->arena.makeList<ast::Expression>(scratch, mark);
+    scratch.resize(mark);
+    return list;
 }
 
 std::vector<std::string> Parser::errors() const{
@@ -214,19 +316,24 @@ void Parser::nextToken() {
 }
 
 std::shared_ptr<ast::Program> Parser::parseProgram() {
-    auto program = std::make_shared<ast::Program>();
-    
+    auto result = std::make_shared<ast::Program>();
+    program = result.get();
+    size_t mark = scratch.size();
+
     while (curToken.type != token::TokenType::EOF_TOKEN) {
         auto stmt = parseStatement();
         if (stmt != nullptr) {
-            program->statements.push_back(stmt);
+            scratch.push_back(stmt);
         }
         nextToken();
     }
-    return program;
+    program->statements = program->arena.makeList<ast::Statement>(scratch, mark);
+    scratch.resize(mark);
+    program = nullptr;
+    return result;
 }
 
-std::shared_ptr<ast::Statement> Parser::parseStatement() {
+ast::Statement* Parser::parseStatement() {
     if (curToken.type == token::TokenType::LET) {
         return parseLetStatement();
     } else if (curToken.type == token::TokenType::RETURN) {
@@ -236,36 +343,39 @@ std::shared_ptr<ast::Statement> Parser::parseStatement() {
     }
 }
 
-std::shared_ptr<ast::LetStatement> Parser::parseLetStatement() {
-    auto stmt = std::make_shared<ast::LetStatement>(curToken, nullptr, nullptr);
+ast::LetStatement* Parser::parseLetStatement() {
+    auto stmt = program->arena.make<ast::LetStatement>(nullptr, nullptr);
     if (!expectPeek(token::TokenType::IDENT)) {
         return nullptr;
     }
-    stmt->name = std::make_shared<ast::Identifier>(curToken, curToken.literal);
+    stmt->name = static_cast<ast::Identifier*>(parseIdentifier());
     if (!expectPeek(token::TokenType::ASSIGN)) {
         return nullptr;
     }
     nextToken();
     stmt->value = parseExpression(LOWEST);
-    while (!curTokenIs(token::TokenType::SEMICOLON)) {
+    if (stmt->value != nullptr && stmt->value->kind == ast::NodeKind::FUNCTION_LITERAL) {
+        static_cast<ast::FunctionLiteral*>(stmt->value)->name = stmt->name->value;
+    }
+    if (peekTokenIs(token::TokenType::SEMICOLON)) {
         nextToken();
     }
 
     return stmt;
 }
 
-std::shared_ptr<ast::ReturnStatement> Parser::parseReturnStatement() {
-    auto stmt = std::make_shared<ast::ReturnStatement>(curToken, nullptr);
+ast::ReturnStatement* Parser::parseReturnStatement() {
+    auto stmt = program->arena.make<ast::ReturnStatement>(nullptr);
     nextToken();
     stmt->returnValue = parseExpression(LOWEST);
-    while (!curTokenIs(token::TokenType::SEMICOLON)) {
+    if (peekTokenIs(token::TokenType::SEMICOLON)) {
         nextToken();
     }
     return stmt;
 }
 
-std::shared_ptr<ast::ExpressionStatement> Parser::parseExpressionStatement() {
-    auto stmt = std::make_shared<ast::ExpressionStatement>(curToken, nullptr);
+ast::ExpressionStatement* Parser::parseExpressionStatement() {
+    auto stmt = program->arena.make<ast::ExpressionStatement>(nullptr);
     stmt->expression = parseExpression(LOWEST);
     if (peekTokenIs(token::TokenType::SEMICOLON)) {
         nextToken();
@@ -273,21 +383,21 @@ std::shared_ptr<ast::ExpressionStatement> Parser::parseExpressionStatement() {
     return stmt;
 }
 
-std::shared_ptr<ast::Expression> Parser::parseExpression(int precedence) {
-    auto prefix = prefixParseFns.find(curToken.type);
-    if (prefix == prefixParseFns.end()) {
+ast::Expression* Parser::parseExpression(int precedence) {
+    PrefixParseFn prefix = prefixParseFns[index(curToken.type)];
+    if (prefix == nullptr) {
         noPrefixParseFnError(curToken.type);
         return nullptr;
     }
-    auto leftExp = prefix->second();
+    auto leftExp = (this->*prefix)();
 
     while (!peekTokenIs(token::TokenType::SEMICOLON) && precedence < peekPrecedence()) {
-        auto infix = infixParseFns.find(peekToken.type);
-        if (infix == infixParseFns.end()) {
+        InfixParseFn infix = infixParseFns[index(peekToken.type)];
+        if (infix == nullptr) {
             return leftExp;
         }
         nextToken();
-        leftExp = infix->second(leftExp);
+        leftExp = (this->*infix)(leftExp);
     }
     return leftExp;
 }
@@ -310,14 +420,6 @@ bool Parser::expectPeek(token::TokenType t) {
     }
 }
 
-void Parser::registerPrefix(token::TokenType tokenType, PrefixParseFn fn) {
-    prefixParseFns[tokenType] = fn;
-}
-
-void Parser::registerInfix(token::TokenType tokenType, InfixParseFn fn) {
-    infixParseFns[tokenType] = fn;
-}
-
 void Parser::noPrefixParseFnError(token::TokenType t) {
     std::string msg = "no prefix parse function found for " + token::tokenTypeToString(t);
     errorMessages.push_back(msg);
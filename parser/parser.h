@@ -1,19 +1,15 @@
 #pragma once
 
+#include <array>
 #include <string>
 #include <vector>
-#include <functional>
 #include <memory>
-#include <unordered_map>
 #include "../lexer/lexer.h"
 #include "../token/token.h"
 #include "../ast/ast.h"
 
 namespace parser {
 
-using PrefixParseFn = std::function<std::shared_ptr<ast::Expression>()>;
-using InfixParseFn = std::function<std::shared_ptr<ast::Expression>(std::shared_ptr<ast::Expression>)>;
-
 enum Precedence {
     LOWEST,
     EQUALS,
@@ -22,8 +18,16 @@ enum Precedence {
     PRODUCT,
     PREFIX,
     CALL,
+    INDEX,
 };
 
+class Parser;
+
+using PrefixParseFn = ast::Expression* (Parser::*)();
+using InfixParseFn = ast::Expression* (Parser::*)(ast::Expression*);
+using PrefixParseTable = std::array<PrefixParseFn, token::TOKEN_TYPE_COUNT>;
+using InfixParseTable = std::array<InfixParseFn, token::TOKEN_TYPE_COUNT>;
+
 class Parser {
 public:
     std::vector<std::string> errors() const;
@@ -35,40 +39,53 @@ private:
     std::vector<std::string> errorMessages;
     token::Token curToken;
     token::Token peekToken;
-    std::unordered_map<token::TokenType, PrefixParseFn> prefixParseFns;
-    std::unordered_map<token::TokenType, InfixParseFn> infixParseFns;
+    ast::Program* program = nullptr; // the program being built; nodes go into its arena
+    // Children collected while a list is being parsed. Nested lists are
+    // pushed on top and popped before their parent continues, so one
+    // buffer serves the whole parse.
+    std::vector<ast::Node*> scratch;
+
+    // Pratt dispatch tables indexed by TokenType. They are built at compile
+    // time and shared by every parser; an empty entry means the token has
+    // no parse function in that position.
+    static const PrefixParseTable prefixParseFns;
+    static const InfixParseTable infixParseFns;
+    static constexpr PrefixParseTable makePrefixParseFns();
+    static constexpr InfixParseTable makeInfixParseFns();
 
     int peekPrecedence() const;
     int curPrecedence() const;
 
-    std::shared_ptr<ast::Expression> parseIdentifier();
-    std::shared_ptr<ast::Expression> parseBoolean();
-    std::shared_ptr<ast::Expression> parseIntegerLiteral();
-    std::shared_ptr<ast::Expression> parsePrefixExpression();
-    std::shared_ptr<ast::Expression> parseInfixExpression(std::shared_ptr<ast::Expression> left);
-    std::shared_ptr<ast::Expression> parseGroupedExpression();
-    std::shared_ptr<ast::Expression> parseIfExpression();
-    std::shared_ptr<ast::BlockStatement> parseBlockStatement();
-    std::shared_ptr<ast::Expression> parseFunctionLiteral();
-    std::vector<std::shared_ptr<ast::Identifier>> parseFunctionParameters();
-    std::shared_ptr<ast::Expression> parseCallExpression(std::shared_ptr<ast::Expression> function);
-    std::vector<std::shared_ptr<ast::Expression>> parseCallArguments();
+    ast::Expression* parseIdentifier();
+    ast::Expression* parseBoolean();
+    ast::Expression* parseIntegerLiteral();
+    ast::Expression* parseStringLiteral();
+    ast::Expression* parsePrefixExpression();
+    ast::Expression* parseInfixExpression(ast::Expression* left);
+    ast::Expression* parseGroupedExpression();
+    ast::Expression* parseIfExpression();
+    ast::BlockStatement* parseBlockStatement();
+    ast::Expression* parseFunctionLiteral();
+    ast::Expression* parseMemoFunctionLiteral();
+    ast::NodeList<ast::Identifier> parseFunctionParameters();
+    ast::Expression* parseCallExpression(ast::Expression* function);
+    ast::Expression* parseArrayLiteral();
+    ast::Expression* parseIndexExpression(ast::Expression* left);
+    ast::Expression* parseHashLiteral();
+    ast::NodeList<ast::Expression> parseExpressionList(token::TokenType end);
 
     void peekError(token::TokenType t);
     void nextToken();
 
-    std::shared_ptr<ast::Statement> parseStatement();
-    std::shared_ptr<ast::LetStatement> parseLetStatement();
-    std::shared_ptr<ast::ReturnStatement> parseReturnStatement();
-    std::shared_ptr<ast::ExpressionStatement> parseExpressionStatement();
-    std::shared_ptr<ast::Expression> parseExpression(int precedence);
+    ast::Statement* parseStatement();
+    ast::LetStatement* parseLetStatement();
+    ast::ReturnStatement* parseReturnStatement();
+    ast::ExpressionStatement* parseExpressionStatement();
+    ast::Expression* parseExpression(int precedence);
 
     bool curTokenIs(token::TokenType t) const;
     bool peekTokenIs(token::TokenType t) const;
     bool expectPeek(token::TokenType t);
-
-    void registerPrefix(token::TokenType tokenType, PrefixParseFn fn);
-    void registerInfix(token::TokenType tokenType, InfixParseFn fn);
     void noPrefixParseFnError(token::TokenType tokenType);
 };
 
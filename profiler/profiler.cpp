@@ -0,0 +1,72 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace profiler {
+
+thread_local Profiler* active = nullptr;
+
+namespace {
+std::string functionName(const ast::FunctionLiteral* literal) {
+    if (!literal->name.empty()) {
+        return std::string(literal->name);
+    }
+    std::string name = "fn(";
+    for (size_t i = 0; i < literal->parameters.size(); i++) {
+        if (i > 0) {
+            name += ", ";
+        }
+        name += literal->parameters[i]->toString();
+    }
+    return name + ")";
+}
+}
+
+void Profiler::enter(const object::Function& fn) {
+    FunctionProfile& profile = profiles[fn.literal];
+    if (profile.program == nullptr) {
+        profile.name = functionName(fn.literal);
+        profile.program = fn.program;
+    }
+    profile.calls++;
+    profile.depth++;
+    stack.push_back(Frame{&profile, Clock::now()});
+}
+
+void Profiler::exit() {
+    Frame frame = stack.back();
+    stack.pop_back();
+
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - frame.start).count();
+    FunctionProfile& profile = *frame.profile;
+    profile.exclusiveNanos += elapsed - frame.childNanos;
+    if (--profile.depth == 0) {
+        profile.inclusiveNanos += elapsed;
+    }
+    if (!stack.empty()) {
+        stack.back().childNanos += elapsed;
+    }
+}
+
+void Profiler::report(std::ostream& out) const {
+    std::vector<const FunctionProfile*> sorted;
+    for (const auto& entry : profiles) {
+        sorted.push_back(&entry.second);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const FunctionProfile* a, const FunctionProfile* b) {
+        return a->exclusiveNanos > b->exclusiveNanos;
+    });
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "%12s %14s %14s %12s  %s\n", "calls", "inclusive ms", "exclusive ms", "allocs", "function");
+    out << line;
+    for (const FunctionProfile* p : sorted) {
+        std::snprintf(line, sizeof(line), "%12llu %14.3f %14.3f %12llu  ",
+                      static_cast<unsigned long long>(p->calls), p->inclusiveNanos / 1e6, p->exclusiveNanos / 1e6,
+                      static_cast<unsigned long long>(p->allocations));
+        out << line << p->name << "\n";
+    }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../ast/ast.h"
+#include "../object/object.h"
+
+namespace profiler {
+
+// Totals for one function literal.
+struct FunctionProfile {
+    std::string name;    // the let name, or the parameter list for anonymous functions
+    uint64_t calls = 0;
+    int64_t inclusiveNanos = 0; // outermost activations only, so recursion is not counted twice
+    int64_t exclusiveNanos = 0; // time not spent in calls made by the function
+    uint64_t allocations = 0;   // evaluator objects allocated by the function itself
+    std::shared_ptr<const ast::Program> program; // keeps the literal, our key, alive
+
+    int depth = 0; // activations currently on the stack
+};
+
+// Per-function call counts, wall times and allocation counts, collected
+// by evaluator::applyFunction while a Profiler is installed as `active`.
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void enter(const object::Function& fn);
+    void exit();
+    void allocation() {
+        if (!stack.empty()) {
+            stack.back().profile->allocations++;
+        }
+    }
+
+    // Prints the profiles sorted by exclusive time, most expensive first.
+    void report(std::ostream& out) const;
+
+private:
+    struct Frame {
+        FunctionProfile* profile;
+        Clock::time_point start;
+        int64_t childNanos = 0;
+    };
+
+    std::unordered_map<const ast::FunctionLiteral*, FunctionProfile> profiles;
+    std::vector<Frame> stack;
+};
+
+// The profiler the evaluator reports to, or nullptr when profiling is off.
+// Checking it is the only cost the evaluator pays without --profile. Each
+// thread has its own; calls made on parallel::forEachChunk's pool threads
+// are not profiled and count toward the time of the caller.
+extern thread_local Profiler* active;
+
+// Installs a profiler, or none, for the lifetime of the scope.
+class Session {
+public:
+    explicit Session(Profiler* profiler) : previous(active) { active = profiler; }
+    ~Session() { active = previous; }
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+private:
+    Profiler* previous;
+};
+
+}
\ No newline at end of file
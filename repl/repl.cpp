@@ -6,6 +6,12 @@
 #include "../lexer/lexer.h"
 #include "../parser/parser.h"
 #include "../evaluator/evaluator.h"
+#include "../resolver/resolver.h"
+#include "../optimizer/optimizer.h"
+#include "../profiler/profiler.h"
+#include "../stats/stats.h"
+#include "../compiler/compiler.h"
+#include "../vm/vm.h"
 #include "../environment/environment.h"
 #include "../object/object.h"
 
@@ -27,8 +33,21 @@ const std::string MONKEY_FACE = R"(
           '~---~'
 )";
 
-void start(std::istream& in, std::ostream& out) {
+namespace {
+// Lines that are commands to the REPL rather than Monkey code. Returns
+// false for anything else.
+bool runCommand(const std::string& line, std::ostream& out) {
+    if (line == ":stats") {
+        stats::current().print(out);
+        return true;
+    }
+    return false;
+}
+
+void startEvaluator(std::istream& in, std::ostream& out, const Options& options) {
     auto env = std::make_shared<object::Environment>();
+    profiler::Profiler functionProfiler;
+    profiler::Session session(options.profile ? &functionProfiler : nullptr);
 
     std::string line;
     while (true) {
@@ -36,8 +55,11 @@ void start(std::istream& in, std::ostream& out) {
         if (!std::getline(in, line)) {
             break;
         }
+        if (runCommand(line, out)) {
+            continue;
+        }
 
-        auto l = std::make_shared<lexer::Lexer>(line);
+        auto l = std::make_shared<lexer::Lexer>(line, lexer::SourceMode::BORROW);
         parser::Parser p(l);
 
         auto program = p.parseProgram();
@@ -46,10 +68,81 @@ void start(std::istream& in, std::ostream& out) {
             continue;
         }
 
+        if (program->statements.empty()) {
+            continue;
+        }
+        if (options.optimize) {
+            optimizer::Optimizer().optimize(program);
+        }
+
+        stats::current().programLoaded(optimizer::countNodes(program.get()), program->arena.bytesUsed());
+        resolver::Resolver(env).resolve(program);
         auto evaluated = evaluator::eval(program, env);
-        if (evaluated != nullptr) {
-            out << evaluated->inspect() << std::endl;
+        out << evaluated.inspect() << std::endl;
+    }
+
+    if (options.profile) {
+        functionProfiler.report(std::cerr);
+    }
+}
+
+void startVM(std::istream& in, std::ostream& out, const Options& options) {
+    // compiler and vm state carried over from line to line
+    auto symbolTable = std::make_shared<compiler::SymbolTable>();
+    std::vector<object::Value> constants;
+    auto globals = std::make_shared<vm::GlobalStore>();
+
+    std::string line;
+    while (true) {
+        out << PROMPT;
+        if (!std::getline(in, line)) {
+            break;
+        }
+        if (runCommand(line, out)) {
+            continue;
         }
+
+        auto l = std::make_shared<lexer::Lexer>(line, lexer::SourceMode::BORROW);
+        parser::Parser p(l);
+
+        auto program = p.parseProgram();
+        if (!p.errors().empty()) {
+            printParserErrors(out, p.errors());
+            continue;
+        }
+
+        if (program->statements.empty()) {
+            continue;
+        }
+        if (options.optimize) {
+            optimizer::Optimizer().optimize(program);
+        }
+
+        stats::current().programLoaded(optimizer::countNodes(program.get()), program->arena.bytesUsed());
+        // compiled against a copy of the symbol table, so a line that fails
+        // to compile leaves no names behind
+        compiler::Compiler comp(std::make_shared<compiler::SymbolTable>(*symbolTable), constants);
+        if (!comp.compile(program)) {
+            for (const auto& msg : comp.errors()) {
+                out << object::Error(msg).inspect() << std::endl;
+            }
+            continue;
+        }
+        symbolTable = comp.symbolTable;
+        constants = comp.constants;
+
+        vm::VM machine(comp.bytecode(), globals);
+        auto result = machine.run();
+        out << result.inspect() << std::endl;
+    }
+}
+}
+
+void start(std::istream& in, std::ostream& out, const Options& options) {
+    if (options.engine == Engine::VM) {
+        startVM(in, out, options);
+    } else {
+        startEvaluator(in, out, options);
     }
 }
 
@@ -5,6 +5,19 @@
 #include <string>
 
 namespace repl {
-    void start(std::istream& in, std::ostream& out);
+    enum class Engine {
+        EVALUATOR, // tree-walking evaluator
+        VM,        // bytecode compiler and stack vm
+    };
+
+    struct Options {
+        Engine engine = Engine::EVALUATOR;
+        bool optimize = false; // run optimizer::Optimizer before evaluation
+        bool profile = false;  // report per-function times at exit (evaluator only)
+        bool stats = false;    // report allocation statistics at exit (see stats::Counters)
+        std::string cacheDirectory; // `run` and `batch` keep parsed scripts here when set (see cache::)
+    };
+
+    void start(std::istream& in, std::ostream& out, const Options& options = Options());
     void printParserErrors(std::ostream& out, const std::vector<std::string>& errors);
 }
\ No newline at end of file
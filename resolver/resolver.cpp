@@ -0,0 +1,246 @@
+#include "resolver.h"
+
+namespace resolver {
+
+Resolver::Resolver(std::shared_ptr<object::Environment> globals) : globals(globals) {}
+
+void Resolver::resolve(const std::shared_ptr<ast::Program>& program) {
+    arena = &program->arena;
+    for (const auto& stmt : program->statements) {
+        resolveStatement(stmt);
+    }
+    resolvePending(pendingGlobal);
+}
+
+int Resolver::resolveRecordScript(const std::shared_ptr<ast::Program>& program, std::unordered_map<std::string_view, int>& fields) {
+    arena = &program->arena;
+    scopes.push_back(Scope{});
+    recordFields = &fields;
+    for (const auto& stmt : program->statements) {
+        resolveStatement(stmt);
+    }
+    resolvePending(scopes.back().pending);
+    recordFields = nullptr;
+    int size = scopes.back().size;
+    scopes.pop_back();
+    return size;
+}
+
+void Resolver::resolveStatement(ast::Statement* stmt) {
+    switch (stmt->kind) {
+        case ast::NodeKind::LET_STATEMENT: {
+            auto letStmt = static_cast<ast::LetStatement*>(stmt);
+            // the value is resolved first, so `let x = x + 1` reads the outer x
+            resolveExpression(letStmt->value);
+            declare(letStmt->name);
+            break;
+        }
+        case ast::NodeKind::RETURN_STATEMENT: {
+            auto returnValue = static_cast<ast::ReturnStatement*>(stmt)->returnValue;
+            resolveExpression(returnValue);
+            if (scopes.size() > (recordFields != nullptr ? 1u : 0u)) {
+                markTailCalls(returnValue);
+            }
+            break;
+        }
+        case ast::NodeKind::EXPRESSION_STATEMENT:
+            resolveExpression(static_cast<ast::ExpressionStatement*>(stmt)->expression);
+            break;
+        case ast::NodeKind::BLOCK_STATEMENT:
+            for (const auto& s : static_cast<ast::BlockStatement*>(stmt)->statements) {
+                resolveStatement(s);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Resolver::resolveExpression(ast::Expression* exp) {
+    if (exp == nullptr) {
+        return;
+    }
+
+    switch (exp->kind) {
+        case ast::NodeKind::IDENTIFIER:
+            lookup(static_cast<ast::Identifier*>(exp));
+            break;
+        case ast::NodeKind::PREFIX_EXPRESSION:
+            resolveExpression(static_cast<ast::PrefixExpression*>(exp)->right);
+            break;
+        case ast::NodeKind::INFIX_EXPRESSION: {
+            auto infix = static_cast<ast::InfixExpression*>(exp);
+            resolveExpression(infix->left);
+            resolveExpression(infix->right);
+            break;
+        }
+        case ast::NodeKind::IF_EXPRESSION: {
+            auto ie = static_cast<ast::IfExpression*>(exp);
+            resolveExpression(ie->condition);
+            resolveStatement(ie->consequence);
+            if (ie->alternative != nullptr) {
+                resolveStatement(ie->alternative);
+            }
+            break;
+        }
+        case ast::NodeKind::FUNCTION_LITERAL: {
+            auto fn = static_cast<ast::FunctionLiteral*>(exp);
+            if (scopes.empty()) {
+                pendingGlobal.push_back(fn);
+            } else {
+                scopes.back().pending.push_back(fn);
+            }
+            break;
+        }
+        case ast::NodeKind::CALL_EXPRESSION: {
+            auto call = static_cast<ast::CallExpression*>(exp);
+            resolveExpression(call->function);
+            for (const auto& arg : call->arguments) {
+                resolveExpression(arg);
+            }
+            break;
+        }
+        case ast::NodeKind::ARRAY_LITERAL:
+            for (const auto& element : static_cast<ast::ArrayLiteral*>(exp)->elements) {
+                resolveExpression(element);
+            }
+            break;
+        case ast::NodeKind::STRING_LITERAL: {
+            auto literal = static_cast<ast::StringLiteral*>(exp);
+            if (literal->constant->object == nullptr) {
+                literal->constant->object = object::intern(literal->value);
+            }
+            break;
+        }
+        case ast::NodeKind::HASH_LITERAL:
+            for (const auto& part : static_cast<ast::HashLiteral*>(exp)->pairs) {
+                resolveExpression(part);
+            }
+            break;
+        case ast::NodeKind::INDEX_EXPRESSION: {
+            auto indexExp = static_cast<ast::IndexExpression*>(exp);
+            resolveExpression(indexExp->left);
+            resolveExpression(indexExp->index);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void Resolver::resolveFunction(ast::FunctionLiteral* fn) {
+    scopes.push_back(Scope{});
+    for (const auto& param : fn->parameters) {
+        declare(param);
+    }
+    for (const auto& stmt : fn->body->statements) {
+        resolveStatement(stmt);
+    }
+    resolvePending(scopes.back().pending);
+
+    auto& stmts = fn->body->statements;
+    if (!stmts.empty() && stmts.back()->kind == ast::NodeKind::EXPRESSION_STATEMENT) {
+        markTailCalls(static_cast<ast::ExpressionStatement*>(stmts.back())->expression);
+    }
+
+    fn->frameSize = scopes.back().size;
+    scopes.pop_back();
+}
+
+void Resolver::resolvePending(std::vector<ast::FunctionLiteral*>& pending) {
+    // taken by value: resolving a function pushes a scope, which may move `pending`
+    auto functions = std::move(pending);
+    pending.clear();
+    for (auto fn : functions) {
+        resolveFunction(fn);
+    }
+}
+
+// Marks the calls whose value becomes the value of `exp`, which is itself
+// in tail position: the call itself, or the last expression of each branch
+// of an if.
+void Resolver::markTailCalls(ast::Expression* exp) {
+    if (exp == nullptr) {
+        return;
+    }
+
+    switch (exp->kind) {
+        case ast::NodeKind::CALL_EXPRESSION:
+            static_cast<ast::CallExpression*>(exp)->tail = true;
+            break;
+        case ast::NodeKind::IF_EXPRESSION: {
+            auto ie = static_cast<ast::IfExpression*>(exp);
+            for (auto block : {ie->consequence, ie->alternative}) {
+                if (block == nullptr || block->statements.empty()) {
+                    continue;
+                }
+                auto last = block->statements.back();
+                if (last->kind == ast::NodeKind::EXPRESSION_STATEMENT) {
+                    markTailCalls(static_cast<ast::ExpressionStatement*>(last)->expression);
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void Resolver::declare(ast::Identifier* name) {
+    name->depth = 0;
+    if (scopes.empty()) {
+        name->slot = globals->define(std::string(name->value));
+        return;
+    }
+
+    Scope& scope = scopes.back();
+    auto it = scope.slots.find(name->value);
+    if (it != scope.slots.end()) {
+        name->slot = it->second;
+    } else {
+        name->slot = scope.size++;
+        scope.slots.emplace(name->value, name->slot);
+    }
+}
+
+void Resolver::lookup(ast::Identifier* ident) {
+    int depth = 0;
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it, ++depth) {
+        auto found = it->slots.find(ident->value);
+        if (found != it->slots.end()) {
+            ident->depth = depth;
+            ident->slot = found->second;
+            // the same name in the enclosing functions, innermost first
+            ast::Identifier* last = ident;
+            for (++it, ++depth; it != scopes.rend(); ++it, ++depth) {
+                auto outer = it->slots.find(ident->value);
+                if (outer != it->slots.end()) {
+                    auto shadowed = arena->make<ast::Identifier>(ident->value);
+                    shadowed->depth = depth;
+                    shadowed->slot = outer->second;
+                    last->shadowed = shadowed;
+                    last = shadowed;
+                }
+            }
+            return;
+        }
+    }
+
+    int slot = globals->slotOf(std::string(ident->value));
+    if (slot >= 0) {
+        ident->depth = depth;
+        ident->slot = slot;
+    } else if (recordFields != nullptr) {
+        Scope& record = scopes.front();
+        ident->depth = depth - 1;
+        ident->slot = record.size++;
+        record.slots.emplace(ident->value, ident->slot);
+        recordFields->emplace(ident->value, ident->slot);
+    } else {
+        // not defined yet, e.g. a global bound by a later REPL line
+        ident->depth = -1;
+        ident->slot = -1;
+    }
+}
+
+}
\ No newline at end of file
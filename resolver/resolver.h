@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "../ast/ast.h"
+#include "../environment/environment.h"
+
+namespace resolver {
+
+// Static pass run between parsing and evaluation. It annotates every
+// ast::Identifier (including the names bound by let statements) with the
+// (depth, slot) of its binding, and every ast::FunctionLiteral with the
+// size of its call frame.
+//
+// Blocks do not open scopes in Monkey, so there is one scope per function
+// body plus the globals table. Function bodies are resolved once the
+// enclosing scope is complete, which lets them refer to names bound after
+// the function literal, itself included. Such a binding may not have run
+// yet when the name is read, so an identifier also records the bindings
+// it shadows (see ast::Identifier::shadowed).
+//
+// It also marks the calls in tail position inside function bodies (see
+// ast::CallExpression::tail) and interns string literals (see
+// ast::StringLiteral::constant).
+class Resolver {
+public:
+    explicit Resolver(std::shared_ptr<object::Environment> globals);
+
+    void resolve(const std::shared_ptr<ast::Program>& program);
+
+    // Resolves a program that runs once per input record (see
+    // runner::runBatch) as if it were the body of a function. Its
+    // top-level lets bind slots of a frame of its own, and the names it
+    // uses without binding them, which the record supplies, become slots
+    // of that frame too. Fills `fields` with those names (views of the
+    // program's arena) and their slots, and returns the frame size.
+    int resolveRecordScript(const std::shared_ptr<ast::Program>& program, std::unordered_map<std::string_view, int>& fields);
+
+private:
+    struct Scope {
+        std::unordered_map<std::string_view, int> slots; // views of names in the program's arena
+        int size = 0;
+        std::vector<ast::FunctionLiteral*> pending;
+    };
+
+    std::shared_ptr<object::Environment> globals;
+    ast::Arena* arena = nullptr; // of the program being resolved
+    std::vector<Scope> scopes; // enclosing function scopes, innermost last
+    std::vector<ast::FunctionLiteral*> pendingGlobal;
+    std::unordered_map<std::string_view, int>* recordFields = nullptr; // scopes[0] is the record script's
+
+    void resolveStatement(ast::Statement* stmt);
+    void resolveExpression(ast::Expression* exp);
+    void resolveFunction(ast::FunctionLiteral* fn);
+    void resolvePending(std::vector<ast::FunctionLiteral*>& pending);
+    void markTailCalls(ast::Expression* exp);
+
+    void declare(ast::Identifier* name);
+    void lookup(ast::Identifier* ident);
+};
+
+}
\ No newline at end of file
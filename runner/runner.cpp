@@ -0,0 +1,604 @@
+#include "runner.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../cache/cache.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../resolver/resolver.h"
+#include "../optimizer/optimizer.h"
+#include "../evaluator/evaluator.h"
+#include "../compiler/compiler.h"
+#include "../vm/vm.h"
+#include "../environment/environment.h"
+#include "../object/object.h"
+#include "../profiler/profiler.h"
+#include "../stats/stats.h"
+
+namespace runner {
+
+namespace {
+// A read-only mapping of a whole file, unmapped on destruction.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = std::strerror(errno);
+            return;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) < 0) {
+            error = std::strerror(errno);
+            ::close(fd);
+            return;
+        }
+        size = static_cast<size_t>(st.st_size);
+        if (size > 0) {
+            void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                error = std::strerror(errno);
+                size = 0;
+            } else {
+                data = static_cast<const char*>(p);
+                ::madvise(p, size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() {
+        if (data != nullptr) {
+            ::munmap(const_cast<char*>(data), size);
+        }
+    }
+
+    bool ok() const { return error.empty(); }
+    std::string_view contents() const { return std::string_view(data, size); }
+
+    std::string error;
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+std::string formatMilliseconds(double ms) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.3f ms", ms);
+    return buf;
+}
+
+// Parses a script, or loads it from the cache directory if one is set and
+// holds an entry for this source; a fresh parse is stored there. Returns
+// nullptr after printing the parser's errors.
+std::shared_ptr<ast::Program> parseScript(std::string_view source, const repl::Options& options, std::ostream& err, bool& cached) {
+    cached = false;
+    if (!options.cacheDirectory.empty()) {
+        if (auto program = cache::load(options.cacheDirectory, source)) {
+            cached = true;
+            return program;
+        }
+    }
+
+    auto l = std::make_shared<lexer::Lexer>(source, lexer::SourceMode::BORROW);
+    parser::Parser p(l);
+    auto program = p.parseProgram();
+    if (!p.errors().empty()) {
+        repl::printParserErrors(err, p.errors());
+        return nullptr;
+    }
+    std::string error;
+    if (!options.cacheDirectory.empty() && !cache::store(options.cacheDirectory, source, *program, error)) {
+        err << "could not write to cache " << options.cacheDirectory << ": " << error << "\n";
+    }
+    return program;
+}
+
+// === Batch mode ===
+// Reads one JSON object per line into Monkey values: integers, booleans,
+// strings, null, arrays of integers and nested objects, which become
+// hashes. Other numbers and arrays are rejected, since the language has no
+// floats and its arrays hold integers only.
+class RecordParser {
+public:
+    // Calls field(key, value) for each member of the record on the line.
+    // Returns false and sets error if the line is not such a record.
+    template <typename Field>
+    bool parse(std::string_view line, Field field) {
+        text = line;
+        pos = 0;
+        error.clear();
+        skipSpace();
+        if (!expect('{')) {
+            return false;
+        }
+        skipSpace();
+        if (peek() == '}') {
+            pos++;
+            return atEnd();
+        }
+        while (true) {
+            skipSpace();
+            object::Value value;
+            if (!parseString(key) || !skipSpaceAndExpect(':') || !parseValue(value, 0)) {
+                return false;
+            }
+            field(std::string_view(key), value);
+            skipSpace();
+            if (peek() == ',') {
+                pos++;
+            } else if (peek() == '}') {
+                pos++;
+                return atEnd();
+            } else {
+                return fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    std::string error;
+
+private:
+    static constexpr int MAX_DEPTH = 64;
+
+    char peek() const { return pos < text.size() ? text[pos] : '\0'; }
+
+    void skipSpace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+            pos++;
+        }
+    }
+
+    bool fail(const std::string& message) {
+        error = message + " at column " + std::to_string(pos + 1);
+        return false;
+    }
+
+    bool expect(char c) {
+        if (peek() != c) {
+            return fail(std::string("expected '") + c + "'");
+        }
+        pos++;
+        return true;
+    }
+
+    bool skipSpaceAndExpect(char c) {
+        skipSpace();
+        return expect(c);
+    }
+
+    bool atEnd() {
+        skipSpace();
+        return pos == text.size() || fail("unexpected text after the record");
+    }
+
+    bool parseValue(object::Value& out, int depth) {
+        skipSpace();
+        char c = peek();
+        if (c == '"') {
+            std::string value;
+            if (!parseString(value)) {
+                return false;
+            }
+            out = object::String::identifierLike(value) ? object::Value(object::intern(value))
+                                                        : object::Value(evaluator::allocate<object::String>(std::move(value)));
+            return true;
+        }
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            int64_t value;
+            if (!parseInteger(value)) {
+                return false;
+            }
+            out = object::Value::integer(value);
+            return true;
+        }
+        if (c == '[') {
+            return parseArray(out);
+        }
+        if (c == '{') {
+            return parseObject(out, depth + 1);
+        }
+        if (text.compare(pos, 4, "true") == 0) {
+            pos += 4;
+            out = object::Value::boolean(true);
+            return true;
+        }
+        if (text.compare(pos, 5, "false") == 0) {
+            pos += 5;
+            out = object::Value::boolean(false);
+            return true;
+        }
+        if (text.compare(pos, 4, "null") == 0) {
+            pos += 4;
+            out = object::Value::null();
+            return true;
+        }
+        return fail("expected a value");
+    }
+
+    bool parseInteger(int64_t& out) {
+        bool negative = peek() == '-';
+        if (negative) {
+            pos++;
+        }
+        if (!(peek() >= '0' && peek() <= '9')) {
+            return fail("expected a digit");
+        }
+        uint64_t magnitude = 0;
+        uint64_t limit = negative ? uint64_t(INT64_MAX) + 1 : uint64_t(INT64_MAX);
+        while (peek() >= '0' && peek() <= '9') {
+            uint64_t digit = static_cast<uint64_t>(peek() - '0');
+            if (magnitude > (limit - digit) / 10) {
+                return fail("integer out of range");
+            }
+            magnitude = magnitude * 10 + digit;
+            pos++;
+        }
+        if (peek() == '.' || peek() == 'e' || peek() == 'E') {
+            return fail("only integers are supported");
+        }
+        out = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+        return true;
+    }
+
+    bool parseArray(object::Value& out) {
+        pos++; // [
+        auto array = evaluator::allocate<object::IntArray>();
+        skipSpace();
+        if (peek() == ']') {
+            pos++;
+            out = array;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            int64_t element;
+            if (!parseInteger(element)) {
+                error = "array elements must be integers: " + error;
+                return false;
+            }
+            array->elements.push_back(element);
+            skipSpace();
+            if (peek() == ',') {
+                pos++;
+            } else if (peek() == ']') {
+                pos++;
+                out = array;
+                return true;
+            } else {
+                return fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    bool parseObject(object::Value& out, int depth) {
+        if (depth > MAX_DEPTH) {
+            return fail("objects nested too deeply");
+        }
+        pos++; // {
+        auto hash = evaluator::allocate<object::Hash>();
+        skipSpace();
+        if (peek() == '}') {
+            pos++;
+            out = hash;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            std::string name;
+            object::Value value;
+            if (!parseString(name) || !skipSpaceAndExpect(':') || !parseValue(value, depth)) {
+                return false;
+            }
+            hash->set(object::String::identifierLike(name) ? object::Value(object::intern(name))
+                                                           : object::Value(evaluator::allocate<object::String>(std::move(name))),
+                      std::move(value));
+            skipSpace();
+            if (peek() == ',') {
+                pos++;
+            } else if (peek() == '}') {
+                pos++;
+                out = hash;
+                return true;
+            } else {
+                return fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    // Decodes a string, including \uXXXX escapes and surrogate pairs, to
+    // UTF-8.
+    bool parseString(std::string& out) {
+        if (!expect('"')) {
+            return false;
+        }
+        out.clear();
+        while (true) {
+            if (pos >= text.size()) {
+                return fail("unterminated string");
+            }
+            char c = text[pos++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            char escape = peek();
+            pos++;
+            switch (escape) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t code;
+                    if (!parseHex(code)) {
+                        return false;
+                    }
+                    if (code >= 0xD800 && code < 0xDC00 && text.compare(pos, 2, "\\u") == 0) {
+                        pos += 2;
+                        uint32_t low;
+                        if (!parseHex(low)) {
+                            return false;
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default:
+                    pos--;
+                    return fail("invalid escape");
+            }
+        }
+    }
+
+    bool parseHex(uint32_t& out) {
+        out = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = peek();
+            uint32_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                digit = static_cast<uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                digit = static_cast<uint32_t>(c - 'A' + 10);
+            } else {
+                return fail("invalid \\u escape");
+            }
+            out = out * 16 + digit;
+            pos++;
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    std::string_view text;
+    size_t pos = 0;
+    std::string key; // the current member's name, reused between records
+};
+
+// Collects output and writes it in large blocks, rather than flushing the
+// stream after every result.
+class BufferedWriter {
+public:
+    explicit BufferedWriter(std::ostream& out) : out(out) { buffer.reserve(CAPACITY); }
+    ~BufferedWriter() { flush(); }
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    void writeLine(std::string_view line) {
+        buffer.append(line);
+        buffer += '\n';
+        if (buffer.size() >= CAPACITY) {
+            flush();
+        }
+    }
+
+    void flush() {
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        out.flush();
+        buffer.clear();
+    }
+
+private:
+    static constexpr size_t CAPACITY = 64 * 1024;
+
+    std::ostream& out;
+    std::string buffer;
+};
+
+double percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+}
+
+int runFile(const std::string& path, const repl::Options& options, std::ostream& out, std::ostream& err) {
+    MappedFile file(path);
+    if (!file.ok()) {
+        err << "could not read " << path << ": " << file.error << "\n";
+        return 1;
+    }
+
+    auto parseStart = Clock::now();
+    bool cached;
+    auto program = parseScript(file.contents(), options, err, cached);
+    double parseTime = millisecondsSince(parseStart);
+    if (program == nullptr) {
+        return 1;
+    }
+
+    if (options.optimize) {
+        auto optimizeStart = Clock::now();
+        optimizer::Options optimizerOptions;
+        optimizerOptions.propagateGlobals = true; // the file is the whole program
+        auto stats = optimizer::Optimizer(optimizerOptions).optimize(program);
+        err << "optimize: " << formatMilliseconds(millisecondsSince(optimizeStart)) << ", " << stats.eliminated() << " of "
+            << stats.nodesBefore << " nodes eliminated (" << stats.folded << " folded, " << stats.branchesRemoved
+            << " branches removed, " << stats.propagated << " constants propagated)\n";
+    }
+    if (options.stats) {
+        stats::current().programLoaded(optimizer::countNodes(program.get()), program->arena.bytesUsed());
+    }
+
+    object::Value result;
+    auto evalStart = Clock::now();
+    if (options.engine == repl::Engine::VM) {
+        compiler::Compiler comp;
+        if (!comp.compile(program)) {
+            for (const auto& msg : comp.errors()) {
+                err << object::Error(msg).inspect() << "\n";
+            }
+            return 1;
+        }
+        vm::VM machine(comp.bytecode());
+        result = machine.run();
+    } else {
+        auto env = object::newEnvironment();
+        resolver::Resolver(env).resolve(program);
+        profiler::Profiler functionProfiler;
+        profiler::Session session(options.profile ? &functionProfiler : nullptr);
+        auto memoBefore = evaluator::memoStats();
+        result = evaluator::eval(program, env);
+        if (options.profile) {
+            functionProfiler.report(err);
+        }
+        auto memo = evaluator::memoStats();
+        if (memo.hits + memo.misses > memoBefore.hits + memoBefore.misses) {
+            err << "memo: " << memo.hits - memoBefore.hits << " hits, " << memo.misses - memoBefore.misses << " misses, "
+                << memo.evictions - memoBefore.evictions << " evictions\n";
+        }
+    }
+    double evalTime = millisecondsSince(evalStart);
+
+    out << result.inspect() << std::endl;
+    err << (cached ? "load: " : "parse: ") << formatMilliseconds(parseTime) << ", eval: " << formatMilliseconds(evalTime) << "\n";
+    return result.is(object::ObjectType::ERROR_OBJ) ? 1 : 0;
+}
+
+
+int runBatch(const std::string& path, const repl::Options& options, std::istream& in, std::ostream& out, std::ostream& err) {
+    MappedFile file(path);
+    if (!file.ok()) {
+        err << "could not read " << path << ": " << file.error << "\n";
+        return 1;
+    }
+
+    bool cached;
+    auto program = parseScript(file.contents(), options, err, cached);
+    if (program == nullptr) {
+        return 1;
+    }
+    if (options.optimize) {
+        optimizer::Optimizer().optimize(program);
+    }
+    if (options.stats) {
+        stats::current().programLoaded(optimizer::countNodes(program.get()), program->arena.bytesUsed());
+    }
+    auto globals = object::newEnvironment();
+    std::unordered_map<std::string_view, int> fields;
+    int frameSize = resolver::Resolver(globals).resolveRecordScript(program, fields);
+
+    profiler::Profiler functionProfiler;
+    profiler::Session session(options.profile ? &functionProfiler : nullptr);
+    BufferedWriter writer(out);
+    RecordParser parser;
+    std::vector<double> latencies; // microseconds per record
+    uint64_t failed = 0;
+    std::shared_ptr<object::Environment> frame;
+    std::string line;
+    size_t lineNumber = 0;
+
+    auto start = Clock::now();
+    while (std::getline(in, line)) {
+        lineNumber++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        auto recordStart = Clock::now();
+        // A frame nothing captured during the previous record is reused.
+        if (frame != nullptr && frame.use_count() == 1) {
+            frame->reset(globals, frameSize);
+        } else {
+            frame = evaluator::allocate<object::Environment>(globals, frameSize);
+        }
+        bool parsed = parser.parse(line, [&](std::string_view name, const object::Value& value) {
+            auto it = fields.find(name);
+            if (it != fields.end()) {
+                frame->set(it->second, value);
+            }
+        });
+        if (parsed) {
+            auto result = evaluator::evalProgram(program->statements, frame);
+            failed += result.is(object::ObjectType::ERROR_OBJ) ? 1 : 0;
+            writer.writeLine(result.inspect());
+        } else {
+            failed++;
+            writer.writeLine(object::Error("invalid record on line " + std::to_string(lineNumber) + ": " + parser.error).inspect());
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - recordStart).count());
+    }
+    writer.flush();
+    double total = millisecondsSince(start);
+
+    if (options.profile) {
+        functionProfiler.report(err);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    char summary[160];
+    std::snprintf(summary, sizeof(summary), "%.0f records/s, latency p50 %.1f us, p99 %.1f us, max %.1f us",
+                  total > 0 ? static_cast<double>(latencies.size()) * 1000 / total : 0.0,
+                  percentile(latencies, 0.50), percentile(latencies, 0.99), latencies.empty() ? 0.0 : latencies.back());
+    err << "batch: " << latencies.size() << " records (" << failed << " failed) in " << formatMilliseconds(total) << ", " << summary << "\n";
+    return failed == 0 ? 0 : 1;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include "../repl/repl.h"
+
+namespace runner {
+
+// Runs a whole script file, as `monkey run file.mk` does. The file is
+// memory-mapped and lexed in place, parsed in one pass, optionally
+// optimized and then evaluated (or compiled and run on the vm). The value of the program is printed to
+// `out`; errors and the parse/eval timings go to `err`.
+//
+// Returns the process exit status: 0 on success, 1 if the file could not
+// be read, failed to parse or ended in an error.
+int runFile(const std::string& path, const repl::Options& options, std::ostream& out, std::ostream& err);
+
+// Runs a script once per input record, as `monkey batch script.mk` does.
+// The script is parsed and resolved once. Every line of `in` holds a
+// record, a JSON object whose members are bound to the names the script
+// uses without defining them, in a fresh frame below an otherwise empty
+// global environment; see resolver::Resolver::resolveRecordScript. Each
+// record's result goes to `out` on a line of its own, through a buffer.
+// Records that are not valid JSON, or use floats or arrays of anything but
+// integers, produce an error line. Records/s and the p50/p99 latency go to
+// `err` at the end. Evaluator only.
+//
+// Returns 0 if every record ran without an error, 1 otherwise.
+int runBatch(const std::string& path, const repl::Options& options, std::istream& in, std::ostream& out, std::ostream& err);
+
+}
\ No newline at end of file
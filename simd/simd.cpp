@@ -0,0 +1,267 @@
+#include "simd.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MONKEY_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace simd {
+
+namespace {
+// === Scalar kernels ===
+// Unsigned arithmetic, so overflow wraps instead of being undefined.
+int64_t sumScalar(const int64_t* a, size_t n) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += static_cast<uint64_t>(a[i]);
+    }
+    return static_cast<int64_t>(total);
+}
+
+int64_t minScalar(const int64_t* a, size_t n) {
+    int64_t result = a[0];
+    for (size_t i = 1; i < n; i++) {
+        result = a[i] < result ? a[i] : result;
+    }
+    return result;
+}
+
+int64_t maxScalar(const int64_t* a, size_t n) {
+    int64_t result = a[0];
+    for (size_t i = 1; i < n; i++) {
+        result = a[i] > result ? a[i] : result;
+    }
+    return result;
+}
+
+int64_t dotScalar(const int64_t* a, const int64_t* b, size_t n) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += static_cast<uint64_t>(a[i]) * static_cast<uint64_t>(b[i]);
+    }
+    return static_cast<int64_t>(total);
+}
+
+void addScalar(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = static_cast<int64_t>(static_cast<uint64_t>(a[i]) + static_cast<uint64_t>(b[i]));
+    }
+}
+
+void mulScalar(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = static_cast<int64_t>(static_cast<uint64_t>(a[i]) * static_cast<uint64_t>(b[i]));
+    }
+}
+
+size_t filterGreaterScalar(const int64_t* a, size_t n, int64_t threshold, int64_t* out) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        out[count] = a[i];
+        count += a[i] > threshold;
+    }
+    return count;
+}
+
+#ifdef MONKEY_SIMD_AVX2
+// === AVX2 kernels ===
+// Four lanes per vector; the remaining n % 4 elements go through the
+// scalar kernels.
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 int64_t horizontalSum(__m256i v) {
+    __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return static_cast<int64_t>(static_cast<uint64_t>(_mm_cvtsi128_si64(sum)) +
+                                static_cast<uint64_t>(_mm_extract_epi64(sum, 1)));
+}
+
+// The low 64 bits of each lane's product. AVX2 only multiplies 32-bit
+// halves, so the product is assembled from three of them.
+AVX2 __m256i multiply(__m256i a, __m256i b) {
+    __m256i low = _mm256_mul_epu32(a, b);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)),
+                                     _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b));
+    return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+
+AVX2 __m256i load(const int64_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+AVX2 void store(int64_t* p, __m256i v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+}
+
+AVX2 int64_t sumAvx2(const int64_t* a, size_t n) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_epi64(acc0, load(a + i));
+        acc1 = _mm256_add_epi64(acc1, load(a + i + 4));
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm256_add_epi64(acc0, load(a + i));
+    }
+    uint64_t total = static_cast<uint64_t>(horizontalSum(_mm256_add_epi64(acc0, acc1)));
+    return static_cast<int64_t>(total + static_cast<uint64_t>(sumScalar(a + i, n - i)));
+}
+
+AVX2 int64_t minAvx2(const int64_t* a, size_t n) {
+    if (n < 4) {
+        return minScalar(a, n);
+    }
+    __m256i result = load(a);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = load(a + i);
+        result = _mm256_blendv_epi8(result, v, _mm256_cmpgt_epi64(result, v));
+    }
+    alignas(32) int64_t lanes[4];
+    store(lanes, result);
+    int64_t m = minScalar(lanes, 4);
+    if (i < n) {
+        int64_t rest = minScalar(a + i, n - i);
+        m = rest < m ? rest : m;
+    }
+    return m;
+}
+
+AVX2 int64_t maxAvx2(const int64_t* a, size_t n) {
+    if (n < 4) {
+        return maxScalar(a, n);
+    }
+    __m256i result = load(a);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = load(a + i);
+        result = _mm256_blendv_epi8(result, v, _mm256_cmpgt_epi64(v, result));
+    }
+    alignas(32) int64_t lanes[4];
+    store(lanes, result);
+    int64_t m = maxScalar(lanes, 4);
+    if (i < n) {
+        int64_t rest = maxScalar(a + i, n - i);
+        m = rest > m ? rest : m;
+    }
+    return m;
+}
+
+AVX2 int64_t dotAvx2(const int64_t* a, const int64_t* b, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_epi64(acc, multiply(load(a + i), load(b + i)));
+    }
+    uint64_t total = static_cast<uint64_t>(horizontalSum(acc));
+    return static_cast<int64_t>(total + static_cast<uint64_t>(dotScalar(a + i, b + i, n - i)));
+}
+
+AVX2 void addAvx2(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        store(out + i, _mm256_add_epi64(load(a + i), load(b + i)));
+    }
+    addScalar(a + i, b + i, out + i, n - i);
+}
+
+AVX2 void mulAvx2(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        store(out + i, multiply(load(a + i), load(b + i)));
+    }
+    mulScalar(a + i, b + i, out + i, n - i);
+}
+
+AVX2 size_t filterGreaterAvx2(const int64_t* a, size_t n, int64_t threshold, int64_t* out) {
+    __m256i limit = _mm256_set1_epi64x(threshold);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = load(a + i);
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, limit)));
+        if (mask == 0) {
+            continue;
+        }
+        if (mask == 0xF) {
+            store(out + count, v);
+            count += 4;
+            continue;
+        }
+        for (int lane = 0; lane < 4; lane++) {
+            out[count] = a[i + lane];
+            count += (mask >> lane) & 1;
+        }
+    }
+    return count + filterGreaterScalar(a + i, n - i, threshold, out + count);
+}
+
+#undef AVX2
+
+bool cpuHasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#else
+bool cpuHasAvx2() {
+    return false;
+}
+#endif
+
+Level best() {
+    static const Level supported = cpuHasAvx2() ? Level::AVX2 : Level::SCALAR;
+    return supported;
+}
+
+Level current = best();
+}
+
+Level level() {
+    return current;
+}
+
+void setLevel(Level requested) {
+    current = requested == Level::AVX2 ? best() : Level::SCALAR;
+}
+
+const char* levelName(Level l) {
+    return l == Level::AVX2 ? "avx2" : "scalar";
+}
+
+#ifdef MONKEY_SIMD_AVX2
+#define DISPATCH(name, ...) (current == Level::AVX2 ? name##Avx2(__VA_ARGS__) : name##Scalar(__VA_ARGS__))
+#else
+#define DISPATCH(name, ...) name##Scalar(__VA_ARGS__)
+#endif
+
+int64_t sum(const int64_t* a, size_t n) {
+    return DISPATCH(sum, a, n);
+}
+
+int64_t min(const int64_t* a, size_t n) {
+    return DISPATCH(min, a, n);
+}
+
+int64_t max(const int64_t* a, size_t n) {
+    return DISPATCH(max, a, n);
+}
+
+int64_t dot(const int64_t* a, const int64_t* b, size_t n) {
+    return DISPATCH(dot, a, b, n);
+}
+
+void add(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    DISPATCH(add, a, b, out, n);
+}
+
+void mul(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    DISPATCH(mul, a, b, out, n);
+}
+
+size_t filterGreater(const int64_t* a, size_t n, int64_t threshold, int64_t* out) {
+    return DISPATCH(filterGreater, a, n, threshold, out);
+}
+
+#undef DISPATCH
+
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace simd {
+
+// Kernels over contiguous int64_t buffers, used by the array builtins.
+// Each has a scalar version and, on x86-64, an AVX2 version that is picked
+// at run time when the CPU supports it. The scalar loops are simple enough
+// for the compiler to vectorize with the baseline SSE2 where it can.
+// Arithmetic wraps around on overflow, in both versions.
+enum class Level {
+    SCALAR,
+    AVX2,
+};
+
+// The kernels in use: the best the CPU supports, unless lowered by setLevel.
+Level level();
+// Selects the kernels, e.g. to compare them in a benchmark. Levels the CPU
+// does not support fall back to SCALAR.
+void setLevel(Level requested);
+const char* levelName(Level l);
+
+int64_t sum(const int64_t* a, size_t n);
+int64_t min(const int64_t* a, size_t n); // n > 0
+int64_t max(const int64_t* a, size_t n); // n > 0
+int64_t dot(const int64_t* a, const int64_t* b, size_t n);
+void add(const int64_t* a, const int64_t* b, int64_t* out, size_t n);
+void mul(const int64_t* a, const int64_t* b, int64_t* out, size_t n);
+// Copies the elements greater than threshold to out, which must have room
+// for n, and returns how many there were.
+size_t filterGreater(const int64_t* a, size_t n, int64_t threshold, int64_t* out);
+
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "stats.h"
+
+#include <cstdio>
+
+namespace stats {
+
+thread_local Counters counters;
+thread_local Counters* active = nullptr;
+
+namespace {
+void merge(Lifetime& into, const Lifetime& from) {
+    into.allocations += from.allocations;
+    into.frees += from.frees;
+    into.live += from.live;
+    if (into.live > into.peak) {
+        into.peak = into.live;
+    }
+    if (from.peak > into.peak) {
+        into.peak = from.peak;
+    }
+}
+
+void printRow(std::ostream& out, const char* name, const Lifetime& counts) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%20s %12llu %12llu %12lld %12lld\n", name,
+                  static_cast<unsigned long long>(counts.allocations), static_cast<unsigned long long>(counts.frees),
+                  static_cast<long long>(counts.live), static_cast<long long>(counts.peak));
+    out << line;
+}
+}
+
+void Counters::adopt(Counters& other) {
+    if (&other == this) {
+        return;
+    }
+    for (size_t i = 0; i < OBJECT_TYPES; i++) {
+        merge(objects[i], other.objects[i]);
+    }
+    merge(allObjects, other.allObjects);
+    merge(environments, other.environments);
+    programs += other.programs;
+    astNodes += other.astNodes;
+    astBytes += other.astBytes;
+    other = Counters();
+}
+
+void Counters::print(std::ostream& out) const {
+    out << "stats: " << programs << " programs, " << astNodes << " AST nodes in " << astBytes << " arena bytes\n";
+    char header[160];
+    std::snprintf(header, sizeof(header), "%20s %12s %12s %12s %12s\n", "type", "allocs", "frees", "live", "peak");
+    out << header;
+    for (size_t i = 0; i < OBJECT_TYPES; i++) {
+        if (objects[i].allocations > 0 || objects[i].frees > 0) {
+            printRow(out, object::objectTypeToString(static_cast<object::ObjectType>(i)).c_str(), objects[i]);
+        }
+    }
+    printRow(out, "all objects", allObjects);
+    printRow(out, "ENVIRONMENT", environments);
+}
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include "../object/object.h"
+
+namespace stats {
+
+// Allocations and frees of one kind of object.
+struct Lifetime {
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    int64_t live = 0; // may go negative where objects are freed by another Counters' owner
+    int64_t peak = 0;
+};
+
+// Number of object::ObjectType values; CLOSURE_OBJ must stay the last one.
+constexpr size_t OBJECT_TYPES = static_cast<size_t>(object::ObjectType::CLOSURE_OBJ) + 1;
+
+// What evaluation allocates and frees: the heap objects of each
+// object::ObjectType and the environments the evaluator creates, plus the
+// syntax trees of the programs that were run. Objects are counted by the
+// allocation hook (see evaluator::allocate), which the builtins and the
+// batch runner's records go through too; the builtin function objects,
+// the string intern table and the vm are not included.
+//
+// A free is counted by the Counters of the thread that frees the object.
+// Pool threads' counters are adopted by the caller after every batch (see
+// parallel::forEachChunk), and an isolate's by the thread that destroys
+// it, so the totals balance once the work is done. Peaks are per thread.
+//
+// Trivially destructible, so objects freed while a thread exits can still
+// be counted.
+class Counters {
+public:
+    void allocated(object::ObjectType type) {
+        allocated(objects[static_cast<size_t>(type)]);
+        allocated(allObjects);
+    }
+    void freed(object::ObjectType type) {
+        freed(objects[static_cast<size_t>(type)]);
+        freed(allObjects);
+    }
+    void environmentAllocated() { allocated(environments); }
+    void environmentFreed() { freed(environments); }
+
+    // A program about to run, with its number of nodes (see
+    // optimizer::countNodes) and the bytes its arena uses.
+    void programLoaded(uint64_t nodes, size_t arenaBytes) {
+        programs++;
+        astNodes += nodes;
+        astBytes += arenaBytes;
+    }
+
+    const Lifetime& of(object::ObjectType type) const { return objects[static_cast<size_t>(type)]; }
+    const Lifetime& totalObjects() const { return allObjects; } // every type; its peak is the peak of the sum
+    const Lifetime& environmentLifetime() const { return environments; }
+    uint64_t programCount() const { return programs; }
+    uint64_t nodeCount() const { return astNodes; }
+    uint64_t nodeBytes() const { return astBytes; }
+
+    // Takes over another thread's counters, leaving them zeroed. Neither
+    // may be in use by another thread meanwhile.
+    void adopt(Counters& other);
+
+    // One line for the syntax trees, then one row per kind of object that
+    // was allocated or freed.
+    void print(std::ostream& out) const;
+
+private:
+    static void allocated(Lifetime& counts) {
+        counts.allocations++;
+        if (++counts.live > counts.peak) {
+            counts.peak = counts.live;
+        }
+    }
+
+    static void freed(Lifetime& counts) {
+        counts.frees++;
+        counts.live--;
+    }
+
+    Lifetime objects[OBJECT_TYPES];
+    Lifetime allObjects;
+    Lifetime environments;
+    uint64_t programs = 0;
+    uint64_t astNodes = 0;
+    uint64_t astBytes = 0;
+};
+
+// The calling thread's own counters.
+extern thread_local Counters counters;
+
+// The counters of the isolate::Isolate running on the calling thread, or
+// nullptr outside of one.
+extern thread_local Counters* active;
+
+// The counters allocations and frees are charged to.
+inline Counters& current() {
+    return active != nullptr ? *active : counters;
+}
+
+}
@@ -0,0 +1,234 @@
+// Cache entries (see cache.h): every kind of node survives a round trip,
+// the encoding stays the one FORMAT_VERSION 1 was written with, and
+// damaged, stale or foreign entries are rejected rather than decoded.
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "../cache/cache.h"
+#include "../isolate/isolate.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+
+namespace {
+
+// Every kind of node, every operator, a memo fn, hash literals, an if with
+// and without an else, and an integer that needs the longest varint.
+const char* const SOURCE =
+    "let add = fn(a, b) { return a + b; };\n"
+    "let fib = memo fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };\n"
+    "let ops = [1 - 2, 3 * 4, 8 / 2, -5, 9223372036854775807, 0];\n"
+    "let flags = {!true: 1 > 2, 1 == 1: 1 != 2};\n"
+    "let h = {\"one\": 1, 2: \"two\", false: add(1, 2)};\n"
+    "if (h[\"one\"] == 1) { len(ops) };\n"
+    "fib(10) + len(\"text\") + len([]) + h[false] + len(h[2 * 1]);\n";
+
+// The entry the first version of the cache wrote for SOURCE. The header
+// holds native-endian integers, so it is compared on little-endian hosts
+// only; bump cache::FORMAT_VERSION and regenerate it if the encoding
+// changes on purpose.
+const unsigned char FORMAT_1_ENTRY[] = {
+    0x4d, 0x4f, 0x4e, 0x4b, 0x45, 0x59, 0x43, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x04, 0x03, 0x02, 0x01, 0x6e, 0x6e, 0x56, 0x2c, 0x14, 0x72, 0xe7, 0xbe,
+    0x68, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x01, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xcb, 0x99, 0x84, 0xce, 0x8c, 0x93, 0xb8, 0x42,
+    0x0c, 0x03, 0x01, 0x01, 0x03, 0x01, 0x03, 0x05, 0x01, 0x03, 0x03, 0x03,
+    0x04, 0x61, 0x64, 0x64, 0x61, 0x62, 0x66, 0x69, 0x62, 0x6e, 0x6f, 0x70,
+    0x73, 0x66, 0x6c, 0x61, 0x67, 0x73, 0x68, 0x6f, 0x6e, 0x65, 0x74, 0x77,
+    0x6f, 0x6c, 0x65, 0x6e, 0x74, 0x65, 0x78, 0x74, 0x07, 0x02, 0x01, 0x00,
+    0x0b, 0x02, 0x01, 0x01, 0x01, 0x02, 0x09, 0x01, 0x03, 0x07, 0x01, 0x01,
+    0x00, 0x01, 0x02, 0x00, 0x00, 0x02, 0x01, 0x03, 0x0b, 0x01, 0x01, 0x04,
+    0x09, 0x01, 0x04, 0x0a, 0x07, 0x01, 0x04, 0x05, 0x05, 0x04, 0x09, 0x01,
+    0x04, 0x01, 0x04, 0x09, 0x01, 0x04, 0x07, 0x0c, 0x01, 0x03, 0x01, 0x07,
+    0x01, 0x04, 0x01, 0x05, 0x02, 0x00, 0x0c, 0x01, 0x03, 0x01, 0x07, 0x01,
+    0x04, 0x01, 0x05, 0x04, 0x03, 0x01, 0x02, 0x01, 0x05, 0x0d, 0x06, 0x07,
+    0x05, 0x02, 0x01, 0x05, 0x04, 0x07, 0x05, 0x06, 0x02, 0x05, 0x08, 0x07,
+    0x05, 0x10, 0x03, 0x05, 0x04, 0x06, 0x01, 0x05, 0x0a, 0x05, 0xfe, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01, 0x05, 0x00, 0x02, 0x01,
+    0x06, 0x0f, 0x04, 0x06, 0x04, 0x08, 0x01, 0x07, 0x05, 0x02, 0x06, 0x05,
+    0x04, 0x07, 0x05, 0x02, 0x07, 0x05, 0x02, 0x07, 0x05, 0x02, 0x08, 0x05,
+    0x04, 0x02, 0x01, 0x07, 0x0f, 0x06, 0x10, 0x08, 0x05, 0x02, 0x05, 0x04,
+    0x10, 0x09, 0x08, 0x00, 0x0c, 0x01, 0x00, 0x02, 0x05, 0x02, 0x05, 0x04,
+    0x04, 0x0a, 0x07, 0x0e, 0x01, 0x07, 0x10, 0x08, 0x07, 0x05, 0x02, 0x09,
+    0x01, 0x04, 0x0c, 0x01, 0x0a, 0x01, 0x01, 0x05, 0xff, 0x04, 0x07, 0x07,
+    0x07, 0x07, 0x0c, 0x01, 0x03, 0x01, 0x05, 0x14, 0x00, 0x0c, 0x01, 0x0a,
+    0x01, 0x10, 0x0b, 0x00, 0x0c, 0x01, 0x0a, 0x01, 0x0d, 0x00, 0x00, 0x0e,
+    0x01, 0x07, 0x08, 0x00, 0x00, 0x0c, 0x01, 0x0a, 0x01, 0x0e, 0x01, 0x07,
+    0x07, 0x05, 0x04, 0x02, 0x05, 0x02
+};
+
+std::shared_ptr<ast::Program> parse(std::string_view source) {
+    auto l = std::make_shared<lexer::Lexer>(source, lexer::SourceMode::BORROW);
+    parser::Parser p(l);
+    auto program = p.parseProgram();
+    CHECK(p.errors().empty());
+    return program;
+}
+
+// Records the kinds of the nodes reachable from `node` and the operators
+// they use.
+struct Seen {
+    std::set<ast::NodeKind> kinds;
+    std::set<ast::Operator> operators;
+    bool memo = false;
+
+    void node(const ast::Node* n) {
+        if (n == nullptr) {
+            return;
+        }
+        kinds.insert(n->kind);
+        switch (n->kind) {
+            case ast::NodeKind::LET_STATEMENT: {
+                auto let = static_cast<const ast::LetStatement*>(n);
+                node(let->name);
+                node(let->value);
+                break;
+            }
+            case ast::NodeKind::RETURN_STATEMENT:
+                node(static_cast<const ast::ReturnStatement*>(n)->returnValue);
+                break;
+            case ast::NodeKind::EXPRESSION_STATEMENT:
+                node(static_cast<const ast::ExpressionStatement*>(n)->expression);
+                break;
+            case ast::NodeKind::PREFIX_EXPRESSION: {
+                auto prefix = static_cast<const ast::PrefixExpression*>(n);
+                operators.insert(prefix->op);
+                node(prefix->right);
+                break;
+            }
+            case ast::NodeKind::INFIX_EXPRESSION: {
+                auto infix = static_cast<const ast::InfixExpression*>(n);
+                operators.insert(infix->op);
+                node(infix->left);
+                node(infix->right);
+                break;
+            }
+            case ast::NodeKind::BLOCK_STATEMENT:
+                list(static_cast<const ast::BlockStatement*>(n)->statements);
+                break;
+            case ast::NodeKind::IF_EXPRESSION: {
+                auto ie = static_cast<const ast::IfExpression*>(n);
+                node(ie->condition);
+                node(ie->consequence);
+                node(ie->alternative);
+                break;
+            }
+            case ast::NodeKind::FUNCTION_LITERAL: {
+                auto fn = static_cast<const ast::FunctionLiteral*>(n);
+                memo = memo || fn->memoized;
+                list(fn->parameters);
+                node(fn->body);
+                break;
+            }
+            case ast::NodeKind::CALL_EXPRESSION: {
+                auto call = static_cast<const ast::CallExpression*>(n);
+                node(call->function);
+                list(call->arguments);
+                break;
+            }
+            case ast::NodeKind::ARRAY_LITERAL:
+                list(static_cast<const ast::ArrayLiteral*>(n)->elements);
+                break;
+            case ast::NodeKind::INDEX_EXPRESSION: {
+                auto indexExp = static_cast<const ast::IndexExpression*>(n);
+                node(indexExp->left);
+                node(indexExp->index);
+                break;
+            }
+            case ast::NodeKind::HASH_LITERAL:
+                list(static_cast<const ast::HashLiteral*>(n)->pairs);
+                break;
+            default:
+                break;
+        }
+    }
+
+    template <typename T>
+    void list(const ast::NodeList<T>& nodes) {
+        for (const auto n : nodes) {
+            node(n);
+        }
+    }
+};
+
+void testRoundTrip() {
+    auto program = parse(SOURCE);
+    std::string entry = cache::encode(SOURCE, *program);
+    auto decoded = cache::decode(entry, SOURCE);
+    CHECK(decoded != nullptr);
+    if (decoded == nullptr) {
+        return;
+    }
+
+    CHECK_EQ(decoded->toString(), program->toString());
+    // function names are not part of toString
+    CHECK(cache::encode(SOURCE, *decoded) == entry);
+
+    Seen seen;
+    seen.list(decoded->statements);
+    for (int kind = static_cast<int>(ast::NodeKind::IDENTIFIER); kind <= static_cast<int>(ast::NodeKind::STRING_LITERAL); kind++) {
+        if (seen.kinds.count(static_cast<ast::NodeKind>(kind)) == 0) {
+            check::fail(__FILE__, __LINE__, "no node of kind " + std::to_string(kind) + " in SOURCE");
+        }
+    }
+    CHECK_EQ(seen.operators.size(), ast::OPERATOR_COUNT);
+    CHECK(seen.memo);
+
+    isolate::Isolate isolate;
+    CHECK_EQ(isolate.run(decoded).inspect(), std::string("65"));
+}
+
+void testFormatUnchanged() {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    std::string golden(reinterpret_cast<const char*>(FORMAT_1_ENTRY), sizeof(FORMAT_1_ENTRY));
+    CHECK(cache::encode(SOURCE, *parse(SOURCE)) == golden);
+    CHECK(cache::decode(golden, SOURCE) != nullptr);
+#endif
+}
+
+void testDamagedEntries() {
+    auto program = parse(SOURCE);
+    const std::string entry = cache::encode(SOURCE, *program);
+
+    for (size_t length = 0; length < entry.size(); length++) {
+        if (cache::decode(std::string_view(entry).substr(0, length), SOURCE) != nullptr) {
+            check::fail(__FILE__, __LINE__, "entry truncated to " + std::to_string(length) + " bytes decoded");
+        }
+    }
+    CHECK(cache::decode(entry + '\0', SOURCE) == nullptr);
+
+    for (size_t bit = 0; bit < entry.size() * 8; bit++) {
+        std::string flipped = entry;
+        flipped[bit / 8] = static_cast<char>(flipped[bit / 8] ^ (1 << (bit % 8)));
+        if (cache::decode(flipped, SOURCE) != nullptr) {
+            check::fail(__FILE__, __LINE__, "entry with bit " + std::to_string(bit) + " flipped decoded");
+        }
+    }
+
+    // the version follows the eight-byte magic
+    for (uint32_t version : {cache::FORMAT_VERSION - 1, cache::FORMAT_VERSION + 1}) {
+        std::string stale = entry;
+        std::memcpy(&stale[8], &version, sizeof(version));
+        CHECK(cache::decode(stale, SOURCE) == nullptr);
+    }
+
+    // another source, even one of the same length
+    std::string other = SOURCE;
+    other[other.size() - 2] = ' ';
+    CHECK(cache::decode(entry, other) == nullptr);
+    CHECK(cache::decode(entry, "") == nullptr);
+    CHECK(cache::decode("", SOURCE) == nullptr);
+}
+
+}
+
+int main() {
+    testRoundTrip();
+    testFormatUnchanged();
+    testDamagedEntries();
+    return check::result();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+// Assertions for the test programs in this directory. A failed CHECK
+// prints its location and the test carries on, so one run reports every
+// failure; main returns check::result().
+
+#include <cstdio>
+#include <string>
+
+namespace check {
+
+inline int failures = 0;
+
+inline void fail(const char* file, int line, const std::string& message) {
+    std::fprintf(stderr, "%s:%d: %s\n", file, line, message.c_str());
+    failures++;
+}
+
+inline int result() {
+    if (failures > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
+
+}
+
+#define CHECK(cond)                                          \
+    do {                                                     \
+        if (!(cond)) {                                       \
+            check::fail(__FILE__, __LINE__, "failed: " #cond); \
+        }                                                    \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                         \
+    do {                                                                                   \
+        const auto& actual_ = (actual);                                                    \
+        const auto& expected_ = (expected);                                                \
+        if (!(actual_ == expected_)) {                                                     \
+            check::fail(__FILE__, __LINE__, std::string(#actual " == " #expected " failed")); \
+        }                                                                                  \
+    } while (0)
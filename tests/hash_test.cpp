@@ -0,0 +1,154 @@
+// object::Hash (a Robin Hood table over entries kept in insertion order)
+// against std::unordered_map, with random inserts, overwrites and lookups
+// of integer, boolean and string keys through growth, reserve and clear.
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "check.h"
+#include "../object/object.h"
+
+namespace {
+
+using object::Hash;
+using object::String;
+using object::Value;
+
+// A random key and the text the reference map knows it by. Integers 0 and
+// 1 and the booleans are different keys; strings are sometimes interned,
+// sometimes fresh copies and sometimes ropes, which must all hash alike.
+struct Keys {
+    std::mt19937_64 random;
+    uint64_t universe; // how many distinct keys of each kind
+
+    std::pair<Value, std::string> next() {
+        uint64_t pick = random() % 8;
+        uint64_t n = random() % universe;
+        if (pick == 0) {
+            bool b = n % 2 == 0;
+            return {Value::boolean(b), b ? "true" : "false"};
+        }
+        if (pick <= 4) {
+            const int64_t edges[] = {0, 1, -1, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()};
+            int64_t i = n < 5 ? edges[n] : static_cast<int64_t>(n * 0x10000) - static_cast<int64_t>(universe);
+            return {Value::integer(i), "i" + std::to_string(i)};
+        }
+        std::string text = "key " + std::to_string(n);
+        if (n % 3 == 0) {
+            text += std::string(80, 'x'); // long enough for concatenation to build a rope
+        }
+        switch (random() % 3) {
+            case 0:
+                return {Value(object::intern(text)), "s" + text};
+            case 1:
+                return {Value(std::make_shared<String>(text)), "s" + text};
+            default: {
+                size_t half = text.size() / 2;
+                auto left = std::make_shared<String>(text.substr(0, half));
+                auto right = std::make_shared<String>(text.substr(half));
+                return {Value(String::concat(left, right)), "s" + text};
+            }
+        }
+    }
+};
+
+// Every key of the reference is in the table with its value, and the
+// entries are in the order their keys were first inserted.
+void checkSame(const Hash& hash, const std::unordered_map<std::string, int64_t>& reference,
+               const std::vector<std::pair<Value, std::string>>& inserted, const std::string& where) {
+    if (hash.size() != reference.size() || hash.items().size() != inserted.size()) {
+        check::fail(__FILE__, __LINE__, "size differs, " + where);
+        return;
+    }
+    for (size_t i = 0; i < inserted.size(); i++) {
+        const Value* value = hash.get(inserted[i].first);
+        if (value == nullptr || !value->isInteger() || value->integerValue() != reference.at(inserted[i].second)) {
+            check::fail(__FILE__, __LINE__, "lookup of " + inserted[i].second + " differs, " + where);
+        }
+        if (!(hash.items()[i].key == inserted[i].first)) {
+            check::fail(__FILE__, __LINE__, "entry " + std::to_string(i) + " out of insertion order, " + where);
+        }
+    }
+}
+
+void testAgainstUnorderedMap() {
+    std::mt19937_64 random(17);
+    for (int table = 0; table < 50; table++) {
+        // small universes overwrite and miss a lot; large ones grow the table
+        uint64_t universe = table % 2 == 0 ? 1 + random() % 64 : 1 + random() % 20000;
+        size_t operations = 1 + random() % 40000;
+        Keys keys{std::mt19937_64(random()), universe};
+        std::string where = "table " + std::to_string(table);
+
+        auto hash = std::make_shared<Hash>();
+        if (table % 5 == 0) {
+            hash->reserve(random() % 5000);
+        }
+        std::unordered_map<std::string, int64_t> reference;
+        std::vector<std::pair<Value, std::string>> inserted;
+
+        for (size_t op = 0; op < operations; op++) {
+            auto key = keys.next();
+            if (random() % 3 == 0) {
+                auto expected = reference.find(key.second);
+                const Value* value = hash->get(key.first);
+                if ((value != nullptr) != (expected != reference.end())
+                    || (value != nullptr && value->integerValue() != expected->second)) {
+                    check::fail(__FILE__, __LINE__, "lookup of " + key.second + " differs, " + where);
+                }
+                continue;
+            }
+            int64_t value = static_cast<int64_t>(op);
+            if (reference.emplace(key.second, value).second) {
+                inserted.push_back(key);
+            } else {
+                reference[key.second] = value;
+            }
+            hash->set(key.first, Value::integer(value));
+            if (op % 4096 == 0) {
+                checkSame(*hash, reference, inserted, where);
+            }
+        }
+        checkSame(*hash, reference, inserted, where);
+
+        // a cleared table starts over
+        if (table % 7 == 0) {
+            hash->clear();
+            CHECK_EQ(hash->size(), size_t(0));
+            CHECK(hash->get(inserted.front().first) == nullptr);
+            hash->set(inserted.front().first, Value::integer(-1));
+            CHECK(hash->get(inserted.front().first) != nullptr && hash->get(inserted.front().first)->integerValue() == -1);
+            CHECK_EQ(hash->size(), size_t(1));
+        }
+    }
+}
+
+// Keys that are equal across kinds of value only where the language says so.
+void testKeyIdentity() {
+    auto hash = std::make_shared<Hash>();
+    hash->set(Value::integer(1), Value::integer(10));
+    hash->set(Value::boolean(true), Value::integer(20));
+    hash->set(Value::integer(0), Value::integer(30));
+    hash->set(Value::boolean(false), Value::integer(40));
+    hash->set(Value(object::intern("1")), Value::integer(50));
+    CHECK_EQ(hash->size(), size_t(5));
+    CHECK_EQ(hash->get(Value::integer(1))->integerValue(), int64_t(10));
+    CHECK_EQ(hash->get(Value::boolean(true))->integerValue(), int64_t(20));
+    CHECK_EQ(hash->get(Value::integer(0))->integerValue(), int64_t(30));
+    CHECK_EQ(hash->get(Value::boolean(false))->integerValue(), int64_t(40));
+    CHECK_EQ(hash->get(Value(std::make_shared<String>("1")))->integerValue(), int64_t(50));
+    CHECK(hash->get(Value::integer(2)) == nullptr);
+    CHECK(hash->get(Value(object::intern("2"))) == nullptr);
+}
+
+}
+
+int main() {
+    testAgainstUnorderedMap();
+    testKeyIdentity();
+    return check::result();
+}
@@ -0,0 +1,66 @@
+// Programs whose names resolve to slots (see resolver::Resolver) must
+// behave as if every name were searched for in the enclosing environments
+// when it is read, as the evaluator did before the resolver existed.
+
+#include <string>
+#include <vector>
+#include "check.h"
+#include "../isolate/isolate.h"
+
+namespace {
+
+// Runs source in a fresh isolate and returns the inspected result.
+std::string run(const std::string& source) {
+    isolate::Isolate isolate;
+    std::vector<std::string> errors;
+    auto result = isolate.run(source, errors);
+    if (!errors.empty()) {
+        return "parse error: " + errors.front();
+    }
+    return result.inspect();
+}
+
+void expect(const char* file, int line, const std::string& source, const std::string& expected) {
+    std::string actual = run(source);
+    if (actual != expected) {
+        check::fail(file, line, source + "\n  gave " + actual + ", expected " + expected);
+    }
+}
+
+#define EXPECT_RUN(source, expected) expect(__FILE__, __LINE__, source, expected)
+
+void testBindingsInOrder() {
+    EXPECT_RUN("let x = 1; let f = fn(y) { x + y }; f(2)", "3");
+    EXPECT_RUN("let x = 1; let f = fn() { let x = x + 1; x }; [f(), x]", "[2, 1]");
+    EXPECT_RUN("let f = fn(n) { if (n == 0) { 0 } else { f(n - 1) } }; f(10)", "0");
+    EXPECT_RUN("let f = fn() { let loop = fn(i) { if (i == 0) { 7 } else { loop(i - 1) } }; loop(3) }; f()", "7");
+    EXPECT_RUN("let f = fn() { let a = fn() { b() }; let b = fn() { 5 }; a() }; f()", "5");
+    EXPECT_RUN("let f = fn() { missing }; f()", "ERROR: identifier not found: missing");
+}
+
+// A closure that runs before a later let of a name in an enclosing body
+// reads the binding that let shadows.
+void testClosureBeforeLaterLet() {
+    EXPECT_RUN("let x = 1; let f = fn() { let g = fn() { x }; let r = g(); let x = 2; r }; f()", "1");
+    EXPECT_RUN("let x = 1; let f = fn() { let g = fn() { x }; let r = g(); let x = 2; [r, g()] }; f()", "[1, 2]");
+    EXPECT_RUN("let f = fn() { let x = 10; let m = fn() { let g = fn() { x }; let r = g(); let x = 3; [r, g()] }; m() }; f()",
+               "[10, 3]");
+    EXPECT_RUN("let f = fn() { let g = fn() { x }; let r = g(); let x = 2; r }; f()", "ERROR: identifier not found: x");
+    EXPECT_RUN("let f = fn() { let g = fn() { len }; let r = g(); let len = 2; r }; f()", "builtin function len");
+}
+
+// Blocks do not open scopes, so a let in a branch that did not run leaves
+// the name bound outside.
+void testLetInUntakenBranch() {
+    EXPECT_RUN("let x = 1; let f = fn() { if (1 > 2) { let x = 5; }; x }; f()", "1");
+    EXPECT_RUN("let x = 1; let f = fn() { if (1 < 2) { let x = 5; }; x }; f()", "5");
+}
+
+}
+
+int main() {
+    testBindingsInOrder();
+    testClosureBeforeLaterLet();
+    testLetInUntakenBranch();
+    return check::result();
+}
@@ -0,0 +1,174 @@
+// The scalar and AVX2 kernels (see simd.h) against a plain reference, on
+// every length around the vector width and the unrolled loops' tails,
+// with INT64_MIN and INT64_MAX among the elements so sums and products
+// overflow. Then the array builtins' edge cases through the evaluator.
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "../isolate/isolate.h"
+#include "../simd/simd.h"
+
+namespace {
+
+constexpr int64_t MIN = std::numeric_limits<int64_t>::min();
+constexpr int64_t MAX = std::numeric_limits<int64_t>::max();
+
+// Arrays of length n; the second one is offset by an element, so loads
+// are not all aligned.
+struct Arrays {
+    std::vector<int64_t> a;
+    std::vector<int64_t> bStorage;
+    const int64_t* b() const { return bStorage.data() + 1; }
+};
+
+Arrays makeArrays(size_t n, std::mt19937_64& random) {
+    const int64_t edges[] = {MIN, MAX, MIN + 1, MAX - 1, -1, 0, 1};
+    Arrays arrays;
+    arrays.bStorage.push_back(0);
+    for (size_t i = 0; i < n; i++) {
+        // mostly small values, so filterGreater keeps some and drops some
+        uint64_t pick = random() % 4;
+        arrays.a.push_back(pick == 0 ? edges[random() % 7] : static_cast<int64_t>(random() % 200) - 100);
+        pick = random() % 4;
+        arrays.bStorage.push_back(pick == 0 ? edges[random() % 7] : static_cast<int64_t>(random() % 200) - 100);
+    }
+    return arrays;
+}
+
+void checkKernels(size_t n, const Arrays& arrays, const char* level) {
+    const int64_t* a = arrays.a.data();
+    const int64_t* b = arrays.b();
+    std::string where = std::string(level) + ", n = " + std::to_string(n);
+
+    uint64_t sum = 0;
+    uint64_t dot = 0;
+    int64_t min = n > 0 ? a[0] : 0;
+    int64_t max = min;
+    std::vector<int64_t> added(n), multiplied(n), kept;
+    for (size_t i = 0; i < n; i++) {
+        sum += static_cast<uint64_t>(a[i]);
+        dot += static_cast<uint64_t>(a[i]) * static_cast<uint64_t>(b[i]);
+        min = a[i] < min ? a[i] : min;
+        max = a[i] > max ? a[i] : max;
+        added[i] = static_cast<int64_t>(static_cast<uint64_t>(a[i]) + static_cast<uint64_t>(b[i]));
+        multiplied[i] = static_cast<int64_t>(static_cast<uint64_t>(a[i]) * static_cast<uint64_t>(b[i]));
+        if (a[i] > 0) {
+            kept.push_back(a[i]);
+        }
+    }
+
+    if (simd::sum(a, n) != static_cast<int64_t>(sum)) {
+        check::fail(__FILE__, __LINE__, "sum, " + where);
+    }
+    if (simd::dot(a, b, n) != static_cast<int64_t>(dot)) {
+        check::fail(__FILE__, __LINE__, "dot, " + where);
+    }
+    if (n > 0 && simd::min(a, n) != min) {
+        check::fail(__FILE__, __LINE__, "min, " + where);
+    }
+    if (n > 0 && simd::max(a, n) != max) {
+        check::fail(__FILE__, __LINE__, "max, " + where);
+    }
+
+    std::vector<int64_t> out(n);
+    simd::add(a, b, out.data(), n);
+    if (out != added) {
+        check::fail(__FILE__, __LINE__, "add, " + where);
+    }
+    simd::mul(a, b, out.data(), n);
+    if (out != multiplied) {
+        check::fail(__FILE__, __LINE__, "mul, " + where);
+    }
+    out.assign(n, 0);
+    out.resize(simd::filterGreater(a, n, 0, out.data()));
+    if (out != kept) {
+        check::fail(__FILE__, __LINE__, "filterGreater, " + where);
+    }
+}
+
+void testKernels() {
+    std::vector<size_t> lengths;
+    for (size_t n = 0; n < 70; n++) {
+        lengths.push_back(n);
+    }
+    for (size_t n : {127, 128, 129, 1000, 1001}) {
+        lengths.push_back(n);
+    }
+
+    for (simd::Level level : {simd::Level::SCALAR, simd::Level::AVX2}) {
+        simd::setLevel(level);
+        if (simd::level() != level) {
+            std::printf("simd_test: %s is not supported here, skipped\n", simd::levelName(level));
+            continue;
+        }
+        std::mt19937_64 random(42);
+        for (size_t n : lengths) {
+            for (int round = 0; round < 8; round++) {
+                checkKernels(n, makeArrays(n, random), simd::levelName(level));
+            }
+        }
+
+        // every element the same extreme
+        for (int64_t value : {MIN, MAX}) {
+            std::vector<int64_t> same(37, value);
+            CHECK_EQ(simd::min(same.data(), same.size()), value);
+            CHECK_EQ(simd::max(same.data(), same.size()), value);
+            CHECK_EQ(simd::sum(same.data(), same.size()),
+                     static_cast<int64_t>(static_cast<uint64_t>(value) * same.size()));
+        }
+    }
+    simd::setLevel(simd::Level::AVX2);
+}
+
+std::string run(const std::string& source) {
+    isolate::Isolate isolate;
+    std::vector<std::string> errors;
+    auto result = isolate.run(source, errors);
+    return errors.empty() ? result.inspect() : "parse error: " + errors.front();
+}
+
+void expect(const char* file, int line, const std::string& source, const std::string& expected) {
+    std::string actual = run(source);
+    if (actual != expected) {
+        check::fail(file, line, source + "\n  gave " + actual + ", expected " + expected);
+    }
+}
+
+#define EXPECT_RUN(source, expected) expect(__FILE__, __LINE__, source, expected)
+
+// The builtins around the kernels, at both levels.
+void testBuiltins() {
+    for (simd::Level level : {simd::Level::SCALAR, simd::Level::AVX2}) {
+        simd::setLevel(level);
+        EXPECT_RUN("min([])", "null");
+        EXPECT_RUN("max([])", "null");
+        EXPECT_RUN("sum([])", "0");
+        EXPECT_RUN("dot([], [])", "0");
+        EXPECT_RUN("[] + []", "[]");
+        EXPECT_RUN("filter_gt([], 0)", "[]");
+
+        EXPECT_RUN("dot([1, 2], [1])", "ERROR: array length mismatch: 2 and 1");
+        EXPECT_RUN("[1, 2] + [1]", "ERROR: array length mismatch: 2 and 1");
+        EXPECT_RUN("[1] * [1, 2, 3]", "ERROR: array length mismatch: 1 and 3");
+
+        EXPECT_RUN("[9223372036854775807] + [9223372036854775807]", "[-2]");
+        EXPECT_RUN("sum([9223372036854775807, 1])", "-9223372036854775808");
+        EXPECT_RUN("let m = 0 - 9223372036854775807 - 1; [min([m, 9223372036854775807]), max([m, 9223372036854775807])]",
+                   "[-9223372036854775808, 9223372036854775807]");
+        EXPECT_RUN("let m = 0 - 9223372036854775807 - 1; filter_gt([m, 0, 9223372036854775807, m], m)",
+                   "[0, 9223372036854775807]");
+    }
+    simd::setLevel(simd::Level::AVX2);
+}
+
+}
+
+int main() {
+    testKernels();
+    testBuiltins();
+    return check::result();
+}
@@ -0,0 +1,119 @@
+// The bytecode vm against the tree-walking evaluator: each program must
+// give the same value, or the same error, on both engines.
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "../compiler/compiler.h"
+#include "../isolate/isolate.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../repl/repl.h"
+#include "../vm/vm.h"
+
+namespace {
+
+std::string evaluate(const std::string& source) {
+    isolate::Isolate isolate;
+    std::vector<std::string> errors;
+    auto result = isolate.run(source, errors);
+    return errors.empty() ? result.inspect() : "parse error: " + errors.front();
+}
+
+std::string runVM(const std::string& source) {
+    auto l = std::make_shared<lexer::Lexer>(source, lexer::SourceMode::BORROW);
+    parser::Parser p(l);
+    auto program = p.parseProgram();
+    if (!p.errors().empty()) {
+        return "parse error: " + p.errors().front();
+    }
+    compiler::Compiler comp;
+    if (!comp.compile(program)) {
+        return object::Error(comp.errors().front()).inspect();
+    }
+    vm::VM machine(comp.bytecode());
+    return machine.run().inspect();
+}
+
+void expect(const char* file, int line, const std::string& source, const std::string& expected) {
+    std::string evaluated = evaluate(source);
+    std::string ran = runVM(source);
+    if (evaluated != expected || ran != expected) {
+        check::fail(file, line, source + "\n  evaluator gave " + evaluated + ", vm gave " + ran + ", expected " + expected);
+    }
+}
+
+#define EXPECT_BOTH(source, expected) expect(__FILE__, __LINE__, source, expected)
+
+void testArithmetic() {
+    EXPECT_BOTH("7 / 2", "3");
+    EXPECT_BOTH("1 / 0", "ERROR: division by zero");
+    EXPECT_BOTH("let f = fn(x) { 10 / x }; f(0)", "ERROR: division by zero");
+    EXPECT_BOTH("let m = 0 - 9223372036854775807 - 1; m / (0 - 1)", "-9223372036854775808");
+    EXPECT_BOTH("9223372036854775807 + 1", "-9223372036854775808");
+}
+
+}
+
+// Globals may be used before their let, by functions called after it.
+void testForwardReferences() {
+    EXPECT_BOTH("let g = fn() { h() }; let h = fn() { 1 }; g()", "1");
+    EXPECT_BOTH("let even = fn(n) { if (n == 0) { true } else { odd(n - 1) } };"
+                "let odd = fn(n) { if (n == 0) { false } else { even(n - 1) } };"
+                "{1: even(10), 2: odd(7), 3: even(3)}",
+                "{1: true, 2: true, 3: false}");
+    EXPECT_BOTH("let g = fn() { h() }; let r = g(); let h = fn() { 1 }; r", "ERROR: identifier not found: h");
+    EXPECT_BOTH("let x = x + 1", "ERROR: identifier not found: x");
+    EXPECT_BOTH("let g = fn() { len }; let r = g(); let len = 2; [r(\"ab\"), len]", "[2, 2]");
+    EXPECT_BOTH("if (true) { let y = 3; }; let f = fn() { y }; f()", "3");
+    EXPECT_BOTH("missing", "ERROR: identifier not found: missing");
+}
+
+// A key is checked as soon as it is evaluated, before its value.
+void testHashKeys() {
+    EXPECT_BOTH("{1: 2, true: 3}[true]", "3");
+    EXPECT_BOTH("{[1]: if (true) { return 7; }}; 1", "ERROR: unusable as hash key: INT_ARRAY");
+    EXPECT_BOTH("{[1]: 1 / 0}", "ERROR: unusable as hash key: INT_ARRAY");
+    EXPECT_BOTH("{1: 1 / 0, [1]: 2}", "ERROR: division by zero");
+    EXPECT_BOTH("{1: 2}[[1]]", "ERROR: unusable as hash key: INT_ARRAY");
+    EXPECT_BOTH("{fn(x) { x }: if (true) { return 7; }}; 1", "ERROR: unusable as hash key: FUNCTION");
+}
+
+// Functions are FUNCTIONs in error messages on both engines.
+void testTypeNames() {
+    EXPECT_BOTH("fn(x) { x } + 1", "ERROR: type mismatch: FUNCTION + INTEGER");
+    EXPECT_BOTH("-fn(x) { x }", "ERROR: unknown operator: -FUNCTION");
+    EXPECT_BOTH("[fn(x) { x }]", "ERROR: array elements must be INTEGER, got FUNCTION");
+    EXPECT_BOTH("{1: 2}[fn(x) { x }]", "ERROR: unusable as hash key: FUNCTION");
+    EXPECT_BOTH("fn(x) { x }[0]", "ERROR: index operator not supported: FUNCTION[INTEGER]");
+    EXPECT_BOTH("len(fn(x) { x })", "ERROR: argument to `len` must be INT_ARRAY, STRING or HASH, got FUNCTION");
+    EXPECT_BOTH("let f = fn(x) { x }; f == f", "true");
+}
+
+// The lines of a vm REPL session after its banner, one per prompt.
+std::string replSession(const std::string& input) {
+    std::istringstream in(input);
+    std::ostringstream out;
+    repl::Options options;
+    options.engine = repl::Engine::VM;
+    repl::start(in, out, options);
+    std::string text = out.str();
+    return text.substr(text.find("->"));
+}
+
+// A line that fails to compile leaves no globals behind.
+void testReplLines() {
+    CHECK_EQ(replSession("let a = 1; b\na\nlet a = 2;\na + 1\n"),
+             std::string("->ERROR: identifier not found: b\n->ERROR: identifier not found: a\n->2\n->3\n->"));
+}
+
+int main() {
+    testArithmetic();
+    testForwardReferences();
+    testHashKeys();
+    testTypeNames();
+    testReplLines();
+    return check::result();
+}
@@ -1,5 +1,7 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 namespace token {
@@ -10,6 +12,7 @@ enum class TokenType {
 
     IDENT,
     INT,
+    STRING,
 
     ASSIGN,
     PLUS,
@@ -25,13 +28,17 @@ enum class TokenType {
 
     COMMA,
     SEMICOLON,
+    COLON,
 
     LPAREN,
     RPAREN,
     LBRACE,
     RBRACE,
+    LBRACKET,
+    RBRACKET,
 
     FUNCTION,
+    MEMO,
     LET,
     TRUE,
     FALSE,
@@ -40,18 +47,27 @@ enum class TokenType {
     RETURN,
 };
 
+// Number of token types, for tables indexed by TokenType. RETURN must stay
+// the last enumerator.
+constexpr size_t TOKEN_TYPE_COUNT = static_cast<size_t>(TokenType::RETURN) + 1;
+
+// A token's literal is a view into the lexer's source buffer, and offset is
+// the byte position where it starts. Tokens are only valid while that
+// buffer is.
 struct Token {
     TokenType type;
-    std::string literal;
+    std::string_view literal;
+    uint32_t offset;
 
     Token()
-        : type(TokenType::ILLEGAL), literal("") {}
-    Token(TokenType t, const std::string& lit): type(t), literal(lit) {}
+        : type(TokenType::ILLEGAL), literal(), offset(0) {}
+    Token(TokenType t, std::string_view lit, uint32_t offset = 0): type(t), literal(lit), offset(offset) {}
 };
 
-inline TokenType lookupIdent(const std::string& ident) {
-    static const std::unordered_map<std::string, TokenType> keywords = {
+inline TokenType lookupIdent(std::string_view ident) {
+    static const std::unordered_map<std::string_view, TokenType> keywords = {
         {"fn", TokenType::FUNCTION},
+        {"memo", TokenType::MEMO},
         {"let", TokenType::LET},
         {"true", TokenType::TRUE},
         {"false", TokenType::FALSE},
@@ -73,6 +89,7 @@ inline std::string tokenTypeToString(TokenType type) {
         case TokenType::EOF_TOKEN: return "EOF";
         case TokenType::IDENT: return "IDENT";
         case TokenType::INT: return "INT";
+        case TokenType::STRING: return "STRING";
         case TokenType::ASSIGN: return "ASSIGN";
         case TokenType::PLUS: return "PLUS";
         case TokenType::MINUS: return "MINUS";
@@ -84,12 +101,16 @@ inline std::string tokenTypeToString(TokenType type) {
         case TokenType::EQ: return "EQ";
         case TokenType::NOT_EQ: return "NOT_EQ";
         case TokenType::COMMA: return "COMMA";
+        case TokenType::COLON: return "COLON";
         case TokenType::SEMICOLON: return "SEMICOLON";
         case TokenType::LPAREN: return "LPAREN";
         case TokenType::RPAREN: return "RPAREN";
         case TokenType::LBRACE: return "LBRACE";
         case TokenType::RBRACE: return "RBRACE";
+        case TokenType::LBRACKET: return "LBRACKET";
+        case TokenType::RBRACKET: return "RBRACKET";
         case TokenType::FUNCTION: return "FUNCTION";
+        case TokenType::MEMO: return "MEMO";
         case TokenType::LET: return "LET";
         case TokenType::TRUE: return "TRUE";
         case TokenType::FALSE: return "FALSE";
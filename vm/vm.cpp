@@ -0,0 +1,453 @@
+#include "vm.h"
+
+#include "../builtins/builtins.h"
+
+namespace vm {
+
+using code::Opcode;
+using object::Object;
+using object::Value;
+using object::Error;
+using object::Closure;
+using object::CompiledFunction;
+using object::IntArray;
+using object::Hash;
+using object::String;
+using object::Builtin;
+
+namespace {
+bool isTruthy(const Value& obj) {
+    if (obj.isNull()) return false;
+    if (obj.isBoolean()) return obj.booleanValue();
+    return true;
+}
+
+Value stackOverflow() {
+    return std::make_shared<Error>("stack overflow");
+}
+
+std::string operatorString(Opcode op) {
+    switch (op) {
+        case Opcode::OpAdd: return "+";
+        case Opcode::OpSub: return "-";
+        case Opcode::OpMul: return "*";
+        case Opcode::OpDiv: return "/";
+        case Opcode::OpEqual: return "==";
+        case Opcode::OpNotEqual: return "!=";
+        case Opcode::OpGreaterThan: return ">";
+        case Opcode::OpLessThan: return "<";
+        default: return "?";
+    }
+}
+
+Value operatorError(Opcode op, const Value& left, const Value& right) {
+    auto leftType = object::typeName(left.type());
+    auto rightType = object::typeName(right.type());
+    if (left.type() != right.type()) {
+        return std::make_shared<Error>("type mismatch: " + leftType + " " + operatorString(op) + " " + rightType);
+    }
+    return std::make_shared<Error>("unknown operator: " + leftType + operatorString(op) + rightType);
+}
+}
+
+VM::VM(const compiler::Bytecode& bytecode) : VM(bytecode, std::make_shared<GlobalStore>()) {}
+
+VM::VM(const compiler::Bytecode& bytecode, std::shared_ptr<GlobalStore> globals)
+    : constants(bytecode.constants), globals(globals), globalNames(bytecode.globalNames), stack(STACK_SIZE), frames(MAX_FRAMES) {
+    if (globals->size() < globalNames.size()) {
+        globals->resize(globalNames.size(), Value::undefined());
+    }
+    auto mainFn = std::make_shared<CompiledFunction>(bytecode.instructions, 0, 0);
+    auto mainClosure = std::make_shared<Closure>(mainFn, std::vector<Value>());
+    frames[0] = Frame(mainClosure, 0);
+}
+
+const Value& VM::lastPoppedStackElem() const {
+    return stack[sp];
+}
+
+Value VM::run() {
+    while (currentFrame().ip < static_cast<int>(currentFrame().instructions().size()) - 1) {
+        Frame& frame = currentFrame();
+        frame.ip++;
+
+        int ip = frame.ip;
+        const uint8_t* ins = frame.instructions().data();
+        auto op = static_cast<Opcode>(ins[ip]);
+
+        Value err;
+        switch (op) {
+            case Opcode::OpConstant: {
+                int constIndex = code::readUint16(ins + ip + 1);
+                frame.ip += 2;
+                if (!push(constants[constIndex])) return stackOverflow();
+                break;
+            }
+            case Opcode::OpPop:
+                pop();
+                break;
+
+            case Opcode::OpAdd:
+            case Opcode::OpSub:
+            case Opcode::OpMul:
+            case Opcode::OpDiv:
+                err = executeBinaryOperation(op);
+                break;
+
+            case Opcode::OpEqual:
+            case Opcode::OpNotEqual:
+            case Opcode::OpGreaterThan:
+            case Opcode::OpLessThan:
+                err = executeComparison(op);
+                break;
+
+            case Opcode::OpTrue:
+                if (!push(Value::boolean(true))) return stackOverflow();
+                break;
+            case Opcode::OpFalse:
+                if (!push(Value::boolean(false))) return stackOverflow();
+                break;
+            case Opcode::OpNull:
+                if (!push(Value::null())) return stackOverflow();
+                break;
+
+            case Opcode::OpBang: {
+                auto operand = pop();
+                push(Value::boolean(operand.isBoolean() && !operand.booleanValue()));
+                break;
+            }
+            case Opcode::OpMinus:
+                err = executeMinusOperator();
+                break;
+
+            case Opcode::OpJump: {
+                int pos = code::readUint16(ins + ip + 1);
+                frame.ip = pos - 1;
+                break;
+            }
+            case Opcode::OpJumpNotTruthy: {
+                int pos = code::readUint16(ins + ip + 1);
+                frame.ip += 2;
+                if (!isTruthy(pop())) {
+                    frame.ip = pos - 1;
+                }
+                break;
+            }
+
+            case Opcode::OpSetGlobal: {
+                int globalIndex = code::readUint16(ins + ip + 1);
+                frame.ip += 2;
+                (*globals)[globalIndex] = pop();
+                break;
+            }
+            case Opcode::OpGetGlobal: {
+                int globalIndex = code::readUint16(ins + ip + 1);
+                frame.ip += 2;
+                err = getGlobal(globalIndex);
+                break;
+            }
+            case Opcode::OpSetLocal: {
+                int localIndex = code::readUint8(ins + ip + 1);
+                frame.ip += 1;
+                stack[frame.basePointer + localIndex] = pop();
+                break;
+            }
+            case Opcode::OpGetLocal: {
+                int localIndex = code::readUint8(ins + ip + 1);
+                frame.ip += 1;
+                if (!push(stack[frame.basePointer + localIndex])) return stackOverflow();
+                break;
+            }
+            case Opcode::OpGetFree: {
+                int freeIndex = code::readUint8(ins + ip + 1);
+                frame.ip += 1;
+                if (!push(frame.cl->free[freeIndex])) return stackOverflow();
+                break;
+            }
+            case Opcode::OpCurrentClosure:
+                if (!push(frame.cl)) return stackOverflow();
+                break;
+
+            case Opcode::OpClosure: {
+                int constIndex = code::readUint16(ins + ip + 1);
+                int numFree = code::readUint8(ins + ip + 3);
+                frame.ip += 3;
+                err = pushClosure(constIndex, numFree);
+                break;
+            }
+            case Opcode::OpCall: {
+                int numArgs = code::readUint8(ins + ip + 1);
+                frame.ip += 1;
+                err = executeCall(numArgs);
+                break;
+            }
+            case Opcode::OpArray: {
+                int numElements = code::readUint16(ins + ip + 1);
+                frame.ip += 2;
+                err = buildArray(numElements);
+                break;
+            }
+            case Opcode::OpHash: {
+                int numElements = code::readUint16(ins + ip + 1);
+                frame.ip += 2;
+                err = buildHash(numElements);
+                break;
+            }
+            case Opcode::OpHashKey:
+                if (!Hash::hashable(stack[sp - 1])) {
+                    return std::make_shared<Error>("unusable as hash key: " + object::typeName(stack[sp - 1].type()));
+                }
+                break;
+            case Opcode::OpIndex: {
+                auto index = pop();
+                auto left = pop();
+                err = executeIndexExpression(left, index);
+                break;
+            }
+            case Opcode::OpGetBuiltin: {
+                int builtinIndex = code::readUint8(ins + ip + 1);
+                frame.ip += 1;
+                if (!push(builtins::get(builtinIndex))) return stackOverflow();
+                break;
+            }
+            case Opcode::OpReturnValue: {
+                auto returnValue = pop();
+                if (framesIndex == 1) {
+                    // a top-level return ends the program with its value
+                    return returnValue;
+                }
+                Frame& returning = popFrame();
+                sp = returning.basePointer - 1;
+                push(returnValue);
+                break;
+            }
+            default:
+                return std::make_shared<Error>("unknown opcode: " + std::to_string(static_cast<int>(op)));
+        }
+
+        if (!err.isNull()) {
+            return err;
+        }
+    }
+    return lastPoppedStackElem();
+}
+
+bool VM::pushFrame(const Frame& f) {
+    if (framesIndex >= MAX_FRAMES) {
+        return false;
+    }
+    frames[framesIndex++] = f;
+    return true;
+}
+
+bool VM::push(Value obj) {
+    if (sp >= STACK_SIZE) {
+        return false;
+    }
+    stack[sp++] = std::move(obj);
+    return true;
+}
+
+Value VM::pop() {
+    return stack[--sp];
+}
+
+Value VM::executeBinaryOperation(Opcode op) {
+    auto right = pop();
+    auto left = pop();
+
+    if (left.is(object::ObjectType::INT_ARRAY_OBJ) && right.is(object::ObjectType::INT_ARRAY_OBJ)
+        && (op == Opcode::OpAdd || op == Opcode::OpMul)) {
+        auto result = builtins::elementwise(op == Opcode::OpAdd ? '+' : '*', left, right);
+        if (result.is(object::ObjectType::ERROR_OBJ)) {
+            return result;
+        }
+        push(result);
+        return Value::null();
+    }
+    if (op == Opcode::OpAdd && left.is(object::ObjectType::STRING_OBJ) && right.is(object::ObjectType::STRING_OBJ)) {
+        push(String::concat(std::static_pointer_cast<String>(left.object()), std::static_pointer_cast<String>(right.object())));
+        return Value::null();
+    }
+    if (!left.isInteger() || !right.isInteger()) {
+        return operatorError(op, left, right);
+    }
+
+    auto leftVal = left.integerValue();
+    auto rightVal = right.integerValue();
+    int64_t result = 0;
+    switch (op) {
+        case Opcode::OpAdd: result = object::wrappingAdd(leftVal, rightVal); break;
+        case Opcode::OpSub: result = object::wrappingSubtract(leftVal, rightVal); break;
+        case Opcode::OpMul: result = object::wrappingMultiply(leftVal, rightVal); break;
+        case Opcode::OpDiv:
+            if (rightVal == 0) {
+                return std::make_shared<Error>("division by zero");
+            }
+            result = object::wrappingDivide(leftVal, rightVal);
+            break;
+        default: break;
+    }
+    push(Value::integer(result));
+    return Value::null();
+}
+
+Value VM::executeComparison(Opcode op) {
+    auto right = pop();
+    auto left = pop();
+
+    if (left.isInteger() && right.isInteger()) {
+        auto leftVal = left.integerValue();
+        auto rightVal = right.integerValue();
+        switch (op) {
+            case Opcode::OpEqual: push(Value::boolean(leftVal == rightVal)); break;
+            case Opcode::OpNotEqual: push(Value::boolean(leftVal != rightVal)); break;
+            case Opcode::OpGreaterThan: push(Value::boolean(leftVal > rightVal)); break;
+            case Opcode::OpLessThan: push(Value::boolean(leftVal < rightVal)); break;
+            default: break;
+        }
+        return Value::null();
+    }
+
+    switch (op) {
+        case Opcode::OpEqual:
+            push(Value::boolean(left == right));
+            return Value::null();
+        case Opcode::OpNotEqual:
+            push(Value::boolean(left != right));
+            return Value::null();
+        default:
+            return operatorError(op, left, right);
+    }
+}
+
+// A global read before its let has run is looked up among the builtins,
+// as the evaluator does for a name that is not bound.
+Value VM::getGlobal(int index) {
+    const Value& value = (*globals)[index];
+    if (!value.isUndefined()) {
+        return push(value) ? Value::null() : stackOverflow();
+    }
+    const std::string& name = globalNames[index];
+    int builtin = builtins::indexOf(name);
+    if (builtin < 0) {
+        return std::make_shared<Error>("identifier not found: " + name);
+    }
+    return push(builtins::get(builtin)) ? Value::null() : stackOverflow();
+}
+
+Value VM::executeMinusOperator() {
+    auto operand = pop();
+    if (!operand.isInteger()) {
+        return std::make_shared<Error>("unknown operator: -" + object::typeName(operand.type()));
+    }
+    push(Value::integer(object::wrappingNegate(operand.integerValue())));
+    return Value::null();
+}
+
+Value VM::executeCall(int numArgs) {
+    const Value& callee = stack[sp - 1 - numArgs];
+    if (callee.is(object::ObjectType::BUILTIN_OBJ)) {
+        auto result = static_cast<const Builtin*>(callee.object().get())->fn(&stack[sp - numArgs], numArgs);
+        if (result.is(object::ObjectType::ERROR_OBJ)) {
+            return result;
+        }
+        sp -= numArgs + 1;
+        push(result);
+        return Value::null();
+    }
+    if (!callee.is(object::ObjectType::CLOSURE_OBJ)) {
+        return std::make_shared<Error>("not a function: " + object::typeName(callee.type()));
+    }
+
+    auto cl = std::static_pointer_cast<Closure>(callee.object());
+    if (numArgs != cl->fn->numParameters) {
+        return std::make_shared<Error>("wrong number of arguments: want=" + std::to_string(cl->fn->numParameters) + ", got=" + std::to_string(numArgs));
+    }
+
+    Frame frame(cl, sp - numArgs);
+    if (frame.basePointer + cl->fn->numLocals >= STACK_SIZE || !pushFrame(frame)) {
+        return stackOverflow();
+    }
+    sp = frame.basePointer + cl->fn->numLocals;
+    return Value::null();
+}
+
+Value VM::pushClosure(int constIndex, int numFree) {
+    const Value& constant = constants[constIndex];
+    if (!constant.is(object::ObjectType::COMPILED_FUNCTION_OBJ)) {
+        return std::make_shared<Error>("not a function: " + object::typeName(constant.type()));
+    }
+
+    std::vector<Value> free(stack.begin() + (sp - numFree), stack.begin() + sp);
+    sp -= numFree;
+
+    auto cl = std::make_shared<Closure>(std::static_pointer_cast<CompiledFunction>(constant.object()), free);
+    if (!push(cl)) {
+        return stackOverflow();
+    }
+    return Value::null();
+}
+
+Value VM::buildArray(int numElements) {
+    auto array = std::make_shared<IntArray>();
+    array->elements.reserve(numElements);
+    for (int i = sp - numElements; i < sp; i++) {
+        if (!stack[i].isInteger()) {
+            return std::make_shared<Error>("array elements must be INTEGER, got " + object::typeName(stack[i].type()));
+        }
+        array->elements.push_back(stack[i].integerValue());
+    }
+    sp -= numElements;
+    push(array);
+    return Value::null();
+}
+
+// The stack holds key 0, value 0, key 1, value 1, ..., the keys already
+// checked by OpHashKey.
+Value VM::buildHash(int numElements) {
+    auto hash = std::make_shared<Hash>();
+    hash->reserve(numElements / 2);
+    for (int i = sp - numElements; i < sp; i += 2) {
+        hash->set(stack[i], stack[i + 1]);
+    }
+    sp -= numElements;
+    push(hash);
+    return Value::null();
+}
+
+// Out of range indexes and missing keys give null, as in the evaluator.
+Value VM::executeIndexExpression(const Value& left, const Value& index) {
+    if (left.is(object::ObjectType::HASH_OBJ)) {
+        if (!Hash::hashable(index)) {
+            return std::make_shared<Error>("unusable as hash key: " + object::typeName(index.type()));
+        }
+        const Value* value = static_cast<const Hash*>(left.object().get())->get(index);
+        push(value != nullptr ? *value : Value::null());
+        return Value::null();
+    }
+    if (left.is(object::ObjectType::STRING_OBJ) && index.isInteger()) {
+        const auto& text = static_cast<const String*>(left.object().get())->flat();
+        int64_t i = index.integerValue();
+        if (i < 0 || i >= static_cast<int64_t>(text.size())) {
+            push(Value::null());
+        } else {
+            std::string_view c(&text[i], 1);
+            push(String::identifierLike(c) ? object::intern(c) : std::make_shared<String>(std::string(c)));
+        }
+        return Value::null();
+    }
+    if (!left.is(object::ObjectType::INT_ARRAY_OBJ) || !index.isInteger()) {
+        return std::make_shared<Error>("index operator not supported: " + object::typeName(left.type()) + "[" + object::typeName(index.type()) + "]");
+    }
+    const auto& elements = static_cast<const IntArray*>(left.object().get())->elements;
+    int64_t i = index.integerValue();
+    if (i < 0 || i >= static_cast<int64_t>(elements.size())) {
+        push(Value::null());
+    } else {
+        push(Value::integer(elements[i]));
+    }
+    return Value::null();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "../code/code.h"
+#include "../compiler/compiler.h"
+#include "../object/object.h"
+
+namespace vm {
+
+constexpr int STACK_SIZE = 2048;
+constexpr int MAX_FRAMES = 1024;
+
+// The values of the globals, by the index the compiler gave them. A vm
+// grows it to the number of globals its bytecode names (see
+// compiler::Bytecode::globalNames), unbound.
+using GlobalStore = std::vector<object::Value>;
+
+struct Frame {
+    std::shared_ptr<object::Closure> cl;
+    int ip = -1;
+    int basePointer = 0;
+
+    Frame() {}
+    Frame(std::shared_ptr<object::Closure> cl, int basePointer) : cl(cl), basePointer(basePointer) {}
+
+    const code::Instructions& instructions() const { return cl->fn->instructions; }
+};
+
+class VM {
+public:
+    explicit VM(const compiler::Bytecode& bytecode);
+    // Shares the global store with other VMs, so a REPL can keep its
+    // bindings across lines.
+    VM(const compiler::Bytecode& bytecode, std::shared_ptr<GlobalStore> globals);
+
+    // Runs the program and returns its value: the last popped element, or
+    // an Error object if execution failed.
+    object::Value run();
+
+    const object::Value& lastPoppedStackElem() const;
+
+private:
+    std::vector<object::Value> constants;
+    std::shared_ptr<GlobalStore> globals;
+    std::vector<std::string> globalNames;
+
+    std::vector<object::Value> stack;
+    int sp = 0; // points to the next free slot; the top of the stack is stack[sp-1]
+
+    std::vector<Frame> frames;
+    int framesIndex = 1;
+
+    Frame& currentFrame() { return frames[framesIndex - 1]; }
+    bool pushFrame(const Frame& f);
+    Frame& popFrame() { return frames[--framesIndex]; }
+
+    bool push(object::Value obj);
+    object::Value pop();
+
+    // The execute helpers return an Error object on failure and null otherwise.
+    object::Value executeBinaryOperation(code::Opcode op);
+    object::Value executeComparison(code::Opcode op);
+    object::Value getGlobal(int index);
+    object::Value executeMinusOperator();
+    object::Value executeCall(int numArgs);
+    object::Value pushClosure(int constIndex, int numFree);
+    object::Value buildArray(int numElements);
+    object::Value buildHash(int numElements);
+    object::Value executeIndexExpression(const object::Value& left, const object::Value& index);
+};
+
+}
\ No newline at end of file